@@ -2,16 +2,11 @@
 # define GARENA
 
 #include <virtual_memory.cpp>
+#include <budget.cpp>
 #include <sanitizer/asan_interface.h>
 
-struct Arena {
-	Buffer bytes = {};
-	u64 current = 0;
-	u64 commit = 0;
-	Arena* next = null;
-	u64 flags = 0;
-
-	enum : u64 {
+struct ArenaFlags {
+	enum Flag : u64 {
 		COMMIT_ON_PUSH = 1ull << 0,
 		DECOMMIT_ON_EMPTY = 1ull << 1,
 		FULL_COMMIT = 1ull << 2,
@@ -20,44 +15,155 @@ struct Arena {
 		ALLOW_CHAIN_GROWTH = 1ull << 5,
 		ALLOW_VMEM_REPLACE_GROWTH = 1ull << 6,//! Pointer unstable
 		ALLOW_SCOPE_UNSTABLE = 1ull << 7,
+		NUMA_LOCAL = 1ull << 8,//* each vmem block prefers the node of the thread creating it
+		NUMA_INTERLEAVE = 1ull << 9,//* each vmem block is interleaved over every node
 		FORCE_NONE = 1ull << 63,
 	};
+};
+
+//* flags read from the arena at runtime
+struct DynamicArenaPolicy {
+	static constexpr bool dynamic = true;
+	static constexpr u64 flags = 0;
+};
+
+//* flags known at compile time, every test on them folds away and push only keeps the paths the flags allow
+template<u64 F> struct StaticArenaPolicy {
+	static constexpr bool dynamic = false;
+	static constexpr u64 flags = F;
+};
 
-	inline bool is_stable() { return !(flags & (ALLOW_VMEM_REPLACE_GROWTH | ALLOW_SCOPE_UNSTABLE | ALLOW_FAILURE)); }
+template<typename Policy> struct BasicArena {
+	using enum ArenaFlags::Flag;
 
-	static inline Arena from_buffer(Buffer buffer, u64 flags = 0) {
+	Buffer bytes = {};
+	u64 current = 0;
+	u64 commit = 0;
+	BasicArena* next = null;
+	u64 flags = Policy::flags;
+	MemoryBudget* budget = null;//* charged for every page committed by this arena & its sub arenas
+	static constexpr i32 FORK_FD = -2;
+	i32 fd = -1;//* shared memory owned by arenas from arena_shared, FORK_FD for the views from arena_fork, see snapshot.cpp
+
+	inline bool has(u64 mask) const {
+		if constexpr (Policy::dynamic)
+			return flags & mask;
+		else
+			return Policy::flags & mask;
+	}
+
+	inline bool is_stable() { return !has(ALLOW_VMEM_REPLACE_GROWTH | ALLOW_SCOPE_UNSTABLE | ALLOW_FAILURE); }
+
+	static inline BasicArena from_buffer(Buffer buffer, u64 flags = Policy::flags, MemoryBudget* budget = null) {
+		if constexpr (!Policy::dynamic)
+			flags = Policy::flags;
 		assert(flags & (FULL_COMMIT | COMMIT_ON_PUSH));//* if none of these flags is present, we never have committed memory
-		Arena new_arena = {
+		BasicArena new_arena = {
 			.bytes = buffer,
 			.current = 0,
 			.commit = (flags & FULL_COMMIT) ? buffer.size() : 0,
 			.next = null,
-			.flags = flags
+			.flags = flags,
+			.budget = budget
 		};
-		if (flags & ALLOW_CHAIN_GROWTH)//* preallocates the next arena' slot, avoids all the fuckery when doing growth by self containing the next arenas
-			new_arena.next = &new_arena.push(Arena{});
+		if (flags & ALLOW_CHAIN_GROWTH) {//* preallocates the next arena' slot, avoids all the fuckery when doing growth by self containing the next arenas
+			auto slot = new_arena.push_array<BasicArena>(1);
+			if (slot.size() > 0)//* stays null when even the slot doesn't fit or is over budget, the arena then can't grow
+				new_arena.next = &(slot[0] = BasicArena{});
+		}
 		return new_arena;
 	}
 
-	template<typename T> static inline Arena from_array(Array<T> arr, u64 flags = 0) { return from_buffer(cast<byte>(arr), flags | FULL_COMMIT); }
-	template<typename T, usize S> static inline Arena from_array(const T(&arr)[S], u64 flags = 0) { return from_array(larray(arr), flags | FULL_COMMIT); }
+	template<typename T> static inline BasicArena from_array(Array<T> arr, u64 flags = Policy::flags) {
+		static_assert(Policy::dynamic || (Policy::flags & FULL_COMMIT));
+		return from_buffer(cast<byte>(arr), flags | FULL_COMMIT);
+	}
+	template<typename T, usize S> static inline BasicArena from_array(const T(&arr)[S], u64 flags = Policy::flags) { return from_array(larray(arr), flags | FULL_COMMIT); }
 
 	static constexpr u64 DEFAULT_VMEM_FLAGS = COMMIT_ON_PUSH | DECOMMIT_ON_EMPTY | ALLOW_CHAIN_GROWTH | ALLOW_MOVE_MORPH;
 
-	static inline Arena from_vmem(u64 size, u64 flags = DEFAULT_VMEM_FLAGS) {
-		auto buffer = virtual_reserve(size, flags & FULL_COMMIT);
+	//* prefault_size > 0 commits & faults that prefix in right away, see prefault
+	static inline BasicArena from_vmem(u64 size, u64 flags = Policy::dynamic ? DEFAULT_VMEM_FLAGS : Policy::flags, MemoryBudget* budget = null, u64 prefault_size = 0) {
+		if constexpr (!Policy::dynamic)
+			flags = Policy::flags;
+		if ((flags & FULL_COMMIT) && !budget_charge(budget, size)) {
+			fprintf(stderr, "Failed reservation : over budget, requested=%llu\n", size);
+			assert(flags & ALLOW_FAILURE);
+			return { .flags = flags, .budget = budget };
+		}
+		auto buffer = virtual_reserve(size, flags & FULL_COMMIT, numa_placement(flags));
+		if (buffer.size() == 0) {
+			if (flags & FULL_COMMIT)
+				budget_release(budget, size);
+			fprintf(stderr, "Failed reservation : requested=%llu\n", size);
+			assert(flags & ALLOW_FAILURE);
+			return { .flags = flags, .budget = budget };
+		}
 		if ((flags & FULL_COMMIT))
 			poison(buffer);
-		return from_buffer(buffer, flags);
+		auto new_arena = from_buffer(buffer, flags, budget);
+		if (prefault_size > 0)
+			new_arena.prefault(prefault_size);
+		return new_arena;
 	}
 
-	Arena& commit_all() {
+	//* sub arenas & replaced vmem get placed again, so NUMA_LOCAL follows the thread that grows the arena
+	static NumaPlacement numa_placement(u64 flags) {
+		if (!(flags & (NUMA_LOCAL | NUMA_INTERLEAVE)) || (numa_nodes() & (numa_nodes() - 1)) == 0)//* single node, nothing to place
+			return {};
+		if (flags & NUMA_INTERLEAVE)
+			return { NumaPlacement::INTERLEAVE, numa_nodes() };
+		return { NumaPlacement::PREFERRED, bit<u64>(numa_current_node()) };
+	}
+
+	//* false past the budget's hard limit, which only arenas allowing failure survive
+	inline bool charge(u64 size) {
+		if (budget_charge(budget, size)) [[likely]]
+			return true;
+		fprintf(stderr, "Failed commit : over budget, committed=%llu, requested=%llu\n", commit, size);
+		assert(has(ALLOW_FAILURE));
+		return false;
+	}
+
+	BasicArena& commit_all() {
+		if (!charge(bytes.size() - commit))
+			return *this;
 		virtual_commit(bytes);
 		commit = bytes.size();
 		flags |= FULL_COMMIT;
 		return *this;
 	}
 
+	//* commits & faults in the first size bytes now, so the first pushes don't pay a page fault each
+	//* DECOMMIT_ON_EMPTY & trim give them back like any other committed bytes
+	BasicArena& prefault(u64 size) {
+		size = min(size, u64(bytes.size()));
+		if (!has(FULL_COMMIT) && size > commit) {
+			auto new_commit = min(((size + COMMIT_CHUNK_SIZE - 1) / COMMIT_CHUNK_SIZE) * COMMIT_CHUNK_SIZE, u64(bytes.size()));
+			if (!charge(new_commit - commit))
+				return *this;
+			poison(virtual_commit(bytes.subspan(commit, new_commit - commit)));
+			commit = new_commit;
+		}
+		virtual_prefault(bytes.subspan(0, size));
+		return *this;
+	}
+
+	//* gives back the committed chunks past the used ones, down the chain too, returns the bytes decommitted
+	u64 trim() {
+		u64 released = (next && next->bytes.size() > 0) ? next->trim() : 0;
+		if (has(FULL_COMMIT) || !has(COMMIT_ON_PUSH))
+			return released;
+		auto kept = min(((current + COMMIT_CHUNK_SIZE - 1) / COMMIT_CHUNK_SIZE) * COMMIT_CHUNK_SIZE, u64(bytes.size()));
+		if (kept >= commit)
+			return released;
+		virtual_decommit(bytes.subspan(kept, commit - kept));
+		budget_release(budget, commit - kept);
+		released += commit - kept;
+		commit = kept;
+		return released;
+	}
+
 	static Buffer zero_buff(Buffer buff) {
 		memset(buff.data(), 0, buff.size_bytes());
 		return buff;
@@ -66,13 +172,29 @@ struct Arena {
 	void vmem_release() {
 		if (next) next->vmem_release();
 		if (bytes.size() > 0) {
-			virtual_release(bytes);
+			if (fd == -1)
+				virtual_release(bytes);
+			else
+				shared_memory_unmap(bytes);
+			budget_release(budget, commit);
+			if (fd >= 0)
+				shared_memory_close(fd);
 			*this = {};
 		}
 	}
 
-	inline Arena& vmem_resize(u64 size) {
-		bytes = virtual_remake(bytes, size, current, flags & FULL_COMMIT ? size : commit);
+	//* the new reservation is charged for what it commits, the previous one is left as it was
+	bool vmem_replace(u64 size) {
+		auto new_commit = has(FULL_COMMIT) ? size : min(max(commit, current), size);
+		if (!charge(new_commit))
+			return false;
+		bytes = virtual_remake(bytes, size, current, new_commit, numa_placement(flags));
+		commit = new_commit;
+		return true;
+	}
+
+	inline BasicArena& vmem_resize(u64 size) {
+		vmem_replace(size);
 		return *this;
 	}
 
@@ -90,10 +212,10 @@ struct Arena {
 		return buffer;
 	}
 
-	inline Arena& push_sub_arena(u64 size) {
-		assert(flags & ALLOW_CHAIN_GROWTH);
+	inline BasicArena& push_sub_arena(u64 size) {
+		assert(has(ALLOW_CHAIN_GROWTH));
 		assert(next);
-		*next = from_vmem(size, flags);
+		*next = from_vmem(size, flags, budget);
 		return *next;
 	}
 
@@ -113,7 +235,7 @@ struct Arena {
 	}
 
 	Buffer free_tip() const {
-		const Arena* it;
+		const BasicArena* it;
 		for (it = this; it->next && it->next->bytes.size() > 0; it = it->next);
 		return it->free();
 	}
@@ -123,46 +245,65 @@ struct Arena {
 
 	inline u64 align_padding(u64 align) { return -uintptr_t(free().data()) & (align - 1); }//* based on https://nullprogram.com/blog/2023/09/27/
 
+	//* the bounds compare is the only test left when the policy is static with FULL_COMMIT
 	inline Buffer push_local(u64 size, u64 padding, bool zero_mem = false) {
 		auto extent = size + padding;
-		if (extent > bytes.size() || current > bytes.size() - extent) {
+		if (extent > bytes.size() - current) [[unlikely]] {
 			fprintf(stderr, "Failed allocation : available=%llu, requested=%llu, needed=%llu\n", free().size(), size, extent);
-			assert(flags & ALLOW_FAILURE);
+			assert(has(ALLOW_FAILURE));
 			return {};
 		}
 		u64 start = current + padding;
 		current += extent;
-		if (current > commit && (flags & COMMIT_ON_PUSH)) {
-			u64 prev_commit = commit;
-			commit = min(((current / COMMIT_CHUNK_SIZE) + 1) * COMMIT_CHUNK_SIZE, bytes.size());
-			poison(virtual_commit(commited().subspan(prev_commit)));
+		if (!has(FULL_COMMIT)) {
+			if (current > commit && has(COMMIT_ON_PUSH)) {
+				u64 prev_commit = commit;
+				u64 next_commit = min(((current / COMMIT_CHUNK_SIZE) + 1) * COMMIT_CHUNK_SIZE, bytes.size());
+				if (!charge(next_commit - prev_commit)) [[unlikely]] {
+					current -= extent;
+					return {};
+				}
+				commit = next_commit;
+				poison(virtual_commit(commited().subspan(prev_commit)));
+			}
+			assert(commit >= current);
 		}
-		assert(commit >= current);
 		if (zero_mem)
 			return zero_buff(unpoison(used().subspan(start)));
 		else
 			return unpoison(used().subspan(start));
 	}
 
-	inline Buffer push_bytes(u64 size, u64 align, bool zero_mem = false) {
-		u64 padding = align_padding(align);
-		u64 extent = padding + size;
-
-		//* growth strategies
-		if ((flags & ALLOW_VMEM_REPLACE_GROWTH) && extent > free().size())
-			bytes = virtual_remake(bytes, round_up_bit(bytes.size() + extent), current, flags & FULL_COMMIT ? round_up_bit(bytes.size() + extent) : commit);
-		else if (
-			(flags & ALLOW_CHAIN_GROWTH) &&
-			(
-				extent > free().size() || //* local doesn't have enough space or
-				((next && next->current > 0) && !(flags & ALLOW_SCOPE_UNSTABLE))//* next has data which forbids local to change scope() result
-				)
-			) {
-			if (next->bytes.size() == 0)
-				push_sub_arena(2 * (sizeof(Arena) + max(extent, u64(bytes.size()))));
-			return next->push_bytes(size, align, zero_mem);
+	//* growth strategies, out of the push fast path
+	Buffer push_grow(u64 size, u64 align, bool zero_mem, alloc_site site) {
+		u64 extent = align_padding(align) + size;
+		if (has(ALLOW_VMEM_REPLACE_GROWTH) && extent > free().size()) {
+			if (!vmem_replace(round_up_bit(bytes.size() + extent)))
+				return {};
+			profile_growth(site);
+			profile_alloc(site, size);
+			return push_local(size, align_padding(align), zero_mem);//* the base moved, so does the padding
+		} else if (has(ALLOW_CHAIN_GROWTH) && next) {
+			if (next->bytes.size() == 0) {
+				push_sub_arena(2 * (sizeof(BasicArena) + max(extent, u64(bytes.size()))));
+				if (next->bytes.size() == 0)//* failed reservation, already reported
+					return {};
+				profile_growth(site);
+			}
+			return next->push_bytes(size, align, zero_mem, site);
 		}
+		return push_local(size, align_padding(align), zero_mem);//* fails
+	}
 
+	inline Buffer push_bytes(u64 size, u64 align, bool zero_mem = false, alloc_site site = alloc_site::current()) {
+		u64 padding = align_padding(align);
+		u64 extent = padding + size;
+		if (
+			extent > free().size() || //* local doesn't have enough space or
+			(has(ALLOW_CHAIN_GROWTH) && !has(ALLOW_SCOPE_UNSTABLE) && next && next->current > 0)//* next has data which forbids local to change scope() result
+			) [[unlikely]]
+			return push_grow(size, align, zero_mem, site);
+		profile_alloc(site, size);
 		return push_local(size, padding, zero_mem);
 	}
 
@@ -171,9 +312,10 @@ struct Arena {
 		if (popped == 0)
 			return popped;
 		current -= popped;
-		auto used_flags = flags_override ? flags_override : flags;
+		auto used_flags = flags_override ? flags_override : (Policy::dynamic ? flags : Policy::flags);
 		poison(free().subspan(0, popped));
 		if (current == 0 && (used_flags & DECOMMIT_ON_EMPTY) && !(used_flags & FULL_COMMIT)) {
+			budget_release(budget, commit);
 			commit = 0;
 			virtual_decommit(bytes);
 		}
@@ -194,12 +336,12 @@ struct Arena {
 		}
 	}
 
-	inline Arena& reset() {
-		pop_to((flags & ALLOW_CHAIN_GROWTH) ? sizeof(Arena) : 0);
+	inline BasicArena& reset() {
+		pop_to(has(ALLOW_CHAIN_GROWTH) && next ? sizeof(BasicArena) : 0);
 		return *this;
 	}
 
-	inline Buffer morph(Buffer buffer, u64 size, u64 align) {
+	inline Buffer morph(Buffer buffer, u64 size, u64 align, alloc_site site = alloc_site::current()) {
 		if (buffer.size() == size) return buffer;//* untouched
 
 		bool growing = size > buffer.size();
@@ -210,8 +352,9 @@ struct Arena {
 		auto chain_tip = !next || next->current == 0;
 		auto enough_space = (growing && (diff <= free().size())) || shrinking;
 
-		if (local_tip && (chain_tip || (flags & ALLOW_SCOPE_UNSTABLE)) && enough_space) {//* tip morph
+		if (local_tip && (chain_tip || has(ALLOW_SCOPE_UNSTABLE)) && enough_space) {//* tip morph
 			if (growing) { //*grow tip
+				profile_alloc(site, diff);
 				return Buffer(buffer.begin(), push_local(diff, 0).end());
 			} else { //* shrink tip
 				pop_local(diff);
@@ -219,53 +362,64 @@ struct Arena {
 			}
 		} else if (shrinking) {//* shrink
 			return buffer.subspan(0, size);
-		} else if (flags & ALLOW_MOVE_MORPH) {//* move morph
-			auto new_buffer = push_bytes(size, align);
+		} else if (has(ALLOW_MOVE_MORPH)) {//* move morph
+			auto new_buffer = push_bytes(size, align, false, site);
 			memcpy(new_buffer.data(), buffer.data(), min(buffer.size(), new_buffer.size()));
 			return new_buffer;
 		} else {//* failure
-			assert((fprintf(stderr, "Failed memory morph : initial=%llu, available=%llu, requested=%llu\n", buffer.size(), free().size(), size), flags & ALLOW_FAILURE));
+			assert((fprintf(stderr, "Failed memory morph : initial=%llu, available=%llu, requested=%llu\n", buffer.size(), free().size(), size), has(ALLOW_FAILURE)));
 			return buffer;
 		}
 	}
 
-	template<typename T> inline Array<T> push_array(usize count, bool zero_mem = false) { return cast<T>(push_bytes(count * sizeof(T), alignof(T), zero_mem)); }
+	template<typename T> inline Array<T> push_array(usize count, bool zero_mem = false, alloc_site site = alloc_site::current()) { return cast<T>(push_bytes(count * sizeof(T), alignof(T), zero_mem, site)); }
 
-	template<typename T> inline Array<T> push_array(Array<const T> arr) {
-		auto other = push_array<T>(arr.size());
+	template<typename T> inline Array<T> push_array(Array<const T> arr, alloc_site site = alloc_site::current()) {
+		auto other = push_array<T>(arr.size(), false, site);
 		memcpy(other.data(), arr.data(), arr.size_bytes());
 		return other;
 	}
 
-	template<typename T> inline Array<T> push_array(Array<T> arr) {
-		return push_array(cast<const T>(arr));
+	template<typename T> inline Array<T> push_array(Array<T> arr, alloc_site site = alloc_site::current()) {
+		return push_array(cast<const T>(arr), site);
 	}
 
-	template<typename T> inline Array<T> push_array(LiteralArray<T> arr) { return push_array(larray(arr)); }
+	template<typename T> inline Array<T> push_array(LiteralArray<T> arr, alloc_site site = alloc_site::current()) { return push_array(larray(arr), site); }
 
-	inline string push_string(string str) {
-		auto arr = push_array<char>(str.size() + 1);
+	inline string push_string(string str, alloc_site site = alloc_site::current()) {
+		auto arr = push_array<char>(str.size() + 1, false, site);
 		memcpy(arr.data(), str.data(), str.size());
 		arr[str.size()] = 0;
 		return arr.data();
 	}
 
-	template<typename T> inline T& push(bool zero_mem = false) { return cast<T>(push_bytes(sizeof(T), alignof(T), zero_mem))[0]; }
-	template<typename T> inline T& push(const T& obj) { return cast<T>(push_bytes(sizeof(T), alignof(T)))[0] = obj; }
+	template<typename T> inline T& push(bool zero_mem = false, alloc_site site = alloc_site::current()) { return cast<T>(push_bytes(sizeof(T), alignof(T), zero_mem, site))[0]; }
+	template<typename T> inline T& push(const T& obj, alloc_site site = alloc_site::current()) { return cast<T>(push_bytes(sizeof(T), alignof(T), false, site))[0] = obj; }
 
-	template<typename T> inline Array<T> morph_array(Array<T> arr, u64 count) {
-		return cast<T>(morph(cast<byte>(arr), count * sizeof(T), alignof(T)));
+	template<typename T> inline Array<T> morph_array(Array<T> arr, u64 count, alloc_site site = alloc_site::current()) {
+		return cast<T>(morph(cast<byte>(arr), count * sizeof(T), alignof(T), site));
 	}
 
-	inline Arena& self_contain() { return push(*this); }
+	inline BasicArena& self_contain() { return push(*this); }
 
+	//* printf style, prints straight into a guessed buffer & only prints again when the guess was too small
+	//* see format.cpp for the compile time parsed {} flavour
 	template<typename... Args> string format(const cstr fmt, Args&&... args) {
-		auto size = snprintf(null, 0, fmt, args...);
-		auto str = push_array<char>(size + 1);
-		snprintf(str.data(), size + 1, fmt, args...);
+		auto str = push_array<char>(strlen(fmt) * 2 + 64);
+		u64 size = snprintf(str.data(), str.size(), fmt, args...);
+		auto fits = size < str.size();
+		str = morph_array(str, size + 1);//* shrinks in place at the tip
+		if (str.size() < size + 1)//* the grow failed, str is the truncated guess or empty
+			return string(str.data(), str.size() > 0 ? str.size() - 1 : 0);
+		if (!fits)
+			snprintf(str.data(), size + 1, fmt, args...);
 		return string(str.data(), size);
 	}
 
 };
 
+using Arena = BasicArena<DynamicArenaPolicy>;
+template<u64 F> using StaticArena = BasicArena<StaticArenaPolicy<F>>;
+using FixedArena = StaticArena<ArenaFlags::FULL_COMMIT>;//* over a caller owned buffer, push is an add, an alignment mask & a bounds compare
+
 #endif
@@ -0,0 +1,195 @@
+#ifndef G_BITSET
+# define G_BITSET
+
+#include <utils.cpp>
+#include <simd.cpp>
+#include <arena.cpp>
+#include <sorted.cpp>
+#include <string.h>
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
+
+//* one bit per element, bits past count are kept at 0 so word loops never need a tail mask
+//* rank/select need the block index from build_rank, rebuild it after modifying the set
+
+typedef u64 bitset_lanes __attribute__((vector_size(SIMD_WIDTH)));
+
+//* index of the k-th set bit of word, k < popcount(word)
+inline u32 select_in_word(u64 word, u32 k) {
+#ifdef __BMI2__
+	return ctz(_pdep_u64(bit<u64>(k), word));
+#else
+	for (; k > 0; k--)
+		word &= word - 1;
+	return ctz(word);
+#endif
+}
+
+struct set_bit_iterator {
+	const u64* words;
+	u64 word_count;
+	u64 index;
+	u64 current;
+
+	inline void skip_empty() {
+		while (current == 0 && ++index < word_count)
+			current = words[index];
+	}
+
+	auto& operator++() {
+		current &= current - 1;
+		skip_empty();
+		return *this;
+	}
+	u64 operator*() const { return index * 64 + ctz(current); }
+	bool operator!=(const set_bit_iterator& rhs) const { return index != rhs.index; }
+};
+
+struct BitSet {
+	static constexpr u64 RANK_BLOCK_WORDS = 8;//* a cache line per rank entry
+
+	Array<u64> words;
+	u64 count = 0;
+	Array<u64> ranks = {};//* set bits before each block
+
+	static inline u64 word_count(u64 count) { return (count + 63) / 64; }
+
+	inline bool get(u64 index) const { return (words[index / 64] >> (index % 64)) & 1; }
+	inline void set(u64 index) { words[index / 64] |= bit<u64>(index % 64); }
+	inline void clear(u64 index) { words[index / 64] &= ~bit<u64>(index % 64); }
+	inline void flip(u64 index) { words[index / 64] ^= bit<u64>(index % 64); }
+	inline void assign(u64 index, bool value) { words[index / 64] = (words[index / 64] & ~bit<u64>(index % 64)) | (u64(value) << (index % 64)); }
+
+	inline void trim_tail() {
+		if (count % 64)
+			words.back() &= bit<u64>(count % 64) - 1;
+	}
+
+	BitSet& fill(bool value) {
+		memset(words.data(), value ? 0xff : 0, words.size_bytes());
+		trim_tail();
+		return *this;
+	}
+
+	//* words = op(words, other.words), a vector at a time then word by word
+	template<typename F> BitSet& combine(const BitSet& other, F op) {
+		assert(other.count == count);
+		constexpr u64 LANES = sizeof(bitset_lanes) / sizeof(u64);
+		u64 i = 0;
+		for (; i + LANES <= words.size(); i += LANES) {
+			bitset_lanes a, b;
+			memcpy(&a, words.data() + i, sizeof(a));
+			memcpy(&b, other.words.data() + i, sizeof(b));
+			a = op(a, b);
+			memcpy(words.data() + i, &a, sizeof(a));
+		}
+		for (; i < words.size(); i++)
+			words[i] = op(words[i], other.words[i]);
+		return *this;
+	}
+
+	BitSet& and_with(const BitSet& other) { return combine(other, [](auto a, auto b) { return a & b; }); }
+	BitSet& or_with(const BitSet& other) { return combine(other, [](auto a, auto b) { return a | b; }); }
+	BitSet& andnot_with(const BitSet& other) { return combine(other, [](auto a, auto b) { return a & ~b; }); }
+	BitSet& xor_with(const BitSet& other) { return combine(other, [](auto a, auto b) { return a ^ b; }); }
+	BitSet& invert() {
+		for (auto& w : words)
+			w = ~w;
+		trim_tail();
+		return *this;
+	}
+
+	u64 popcount() const {
+		u64 total = 0;
+		for (auto w : words)
+			total += __builtin_popcountll(w);
+		return total;
+	}
+
+	bool any() const {
+		for (auto w : words) if (w)
+			return true;
+		return false;
+	}
+
+	inline bool none() const { return !any(); }
+
+	BitSet& build_rank(Arena& arena) {
+		auto blocks = (words.size() + RANK_BLOCK_WORDS - 1) / RANK_BLOCK_WORDS;
+		ranks = arena.push_array<u64>(blocks);
+		u64 total = 0;
+		for (auto b : u64xrange{ 0, blocks }) {
+			ranks[b] = total;
+			for (auto i : u64xrange{ b * RANK_BLOCK_WORDS, min((b + 1) * RANK_BLOCK_WORDS, words.size()) })
+				total += __builtin_popcountll(words[i]);
+		}
+		return *this;
+	}
+
+	//* set bits in [0, index)
+	u64 rank(u64 index) const {
+		assert(ranks.size() > 0 || words.size() == 0);
+		if (index >= count)
+			index = count;
+		auto word = index / 64;
+		auto block = min(word / RANK_BLOCK_WORDS, max(ranks.size(), u64(1)) - 1);//* index == count can land one block past the end
+		u64 total = ranks.size() > 0 ? ranks[block] : 0;
+		for (auto i : u64xrange{ block * RANK_BLOCK_WORDS, word })
+			total += __builtin_popcountll(words[i]);
+		if (index % 64)
+			total += __builtin_popcountll(words[word] & (bit<u64>(index % 64) - 1));
+		return total;
+	}
+
+	//* index of the k-th set bit (from 0), -1 when there are k or fewer
+	i64 select(u64 k) const {
+		assert(ranks.size() > 0 || words.size() == 0);
+		auto block = upper_bound(Array<const u64>(ranks), k);
+		if (block == 0)
+			return -1;
+		block--;
+		k -= ranks[block];
+		for (auto i : u64xrange{ block * RANK_BLOCK_WORDS, min((block + 1) * RANK_BLOCK_WORDS, words.size()) }) {
+			u64 bits = __builtin_popcountll(words[i]);
+			if (k < bits)
+				return i * 64 + select_in_word(words[i], k);
+			k -= bits;
+		}
+		return -1;
+	}
+
+	it_range<set_bit_iterator> set_bits() const {
+		set_bit_iterator it = { words.data(), words.size(), 0, words.size() > 0 ? words[0] : 0 };
+		if (words.size() > 0)
+			it.skip_empty();
+		return { it, set_bit_iterator{ words.data(), words.size(), words.size(), 0 } };
+	}
+
+	//* indices of the set bits, ascending
+	Array<u32> to_indices(Arena& arena) const {
+		assert(count <= u64(~0u) + 1);
+		auto indices = arena.push_array<u32>(popcount());
+		u64 n = 0;
+		for (auto i : u64xrange{ 0, words.size() }) for (auto w = words[i]; w; w &= w - 1)
+			indices[n++] = i * 64 + ctz(w);
+		return indices;
+	}
+
+	BitSet clone(Arena& arena) const { return { arena.push_array(Array<const u64>(words)), count }; }
+};
+
+inline BitSet bitset_make(Arena& arena, u64 count) { return { arena.push_array<u64>(BitSet::word_count(count), true), count }; }
+
+inline BitSet bitset_from_indices(Arena& arena, Array<const u32> indices, u64 count) {
+	auto set = bitset_make(arena, count);
+	for (auto i : indices) {
+		assert(i < count);
+		set.set(i);
+	}
+	return set;
+}
+
+inline BitSet bitset_from_indices(Arena& arena, Array<u32> indices, u64 count) { return bitset_from_indices(arena, Array<const u32>(indices), count); }
+
+#endif
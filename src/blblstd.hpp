@@ -9,5 +9,21 @@
 #include <scratch.cpp>
 #include <virtual_memory.cpp>
 #include <high_order.cpp>
+#include <file_stream.cpp>
+#include <snapshot.cpp>
+#include <format.cpp>
+#include <simd.cpp>
+#include <strings.cpp>
+#include <unicode.cpp>
+#include <sorted.cpp>
+#include <parallel.cpp>
+#include <profiler.cpp>
+#include <bitset.cpp>
+#include <slot_map.cpp>
+#include <lru_cache.cpp>
+#include <priority_queue.cpp>
+#include <timer_wheel.cpp>
+#include <packed.cpp>
+#include <budget.cpp>
 
 #endif
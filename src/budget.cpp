@@ -0,0 +1,58 @@
+#ifndef G_BUDGET
+# define G_BUDGET
+
+#include <utils.cpp>
+#include <atomic>
+
+//* commit accounting, a budget charges its parents too so limits nest (process -> subsystem -> arena)
+//* arenas with a budget charge it when they commit pages & release it when they decommit or release them
+//* the soft limit only calls back once when crossed upward, the hard limit refuses the charge
+struct MemoryBudget {
+	using Callback = void(*)(any* context, MemoryBudget& budget);
+	static constexpr u64 UNLIMITED = ~0ull;
+
+	MemoryBudget* parent = null;
+	std::atomic<u64> committed = 0;
+	u64 soft_limit = UNLIMITED;
+	u64 hard_limit = UNLIMITED;
+	Callback on_soft_limit = null;//* may release memory from within, evicting caches or trimming scratches
+	any* context = null;
+	std::atomic<u64> refused = 0;//* charges refused by this budget's hard limit
+};
+
+bool budget_charge_chain(MemoryBudget* budget, u64 bytes);
+void budget_release_chain(MemoryBudget* budget, u64 bytes);
+
+//* null budgets are free, so unbudgeted arenas only pay a compare
+inline bool budget_charge(MemoryBudget* budget, u64 bytes) { return !budget || bytes == 0 || budget_charge_chain(budget, bytes); }
+inline void budget_release(MemoryBudget* budget, u64 bytes) {
+	if (budget && bytes > 0)
+		budget_release_chain(budget, bytes);
+}
+
+#ifdef BLBLSTD_IMPL
+
+bool budget_charge_chain(MemoryBudget* budget, u64 bytes) {
+	for (auto level = budget; level; level = level->parent) {
+		auto before = level->committed.fetch_add(bytes, std::memory_order_relaxed);
+		if (before + bytes > level->hard_limit) {
+			level->committed.fetch_sub(bytes, std::memory_order_relaxed);
+			level->refused.fetch_add(1, std::memory_order_relaxed);
+			for (auto undo = budget; undo != level; undo = undo->parent)
+				undo->committed.fetch_sub(bytes, std::memory_order_relaxed);
+			return false;
+		}
+		if (before < level->soft_limit && before + bytes >= level->soft_limit && level->on_soft_limit)
+			level->on_soft_limit(level->context, *level);
+	}
+	return true;
+}
+
+void budget_release_chain(MemoryBudget* budget, u64 bytes) {
+	for (auto level = budget; level; level = level->parent)
+		level->committed.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+#endif
+
+#endif
@@ -0,0 +1,136 @@
+#ifndef G_FILE_STREAM
+# define G_FILE_STREAM
+
+#include <arena.cpp>
+#include <new>
+#include <thread>
+#include <semaphore>
+
+//* double buffered reader : a worker thread fills the back block while the caller processes the front one
+//* every block is preceded by a carry area of the same size, the unconsumed tail of the previous block is moved there
+//* so records straddling a block boundary are handed out contiguous, without copying the rest of the block
+struct FileStream {
+	FILE* file = null;
+	u64 block_size = 0;
+	Buffer blocks[2] = {};
+	u64 filled[2] = {};
+	u32 front = 1;
+	ROBuffer current = {};
+	bool pending = false;
+	bool eof = false;
+	bool closing = false;
+	std::binary_semaphore requested{ 0 };
+	std::binary_semaphore ready{ 0 };
+	std::thread worker;
+
+	static constexpr u64 DEFAULT_BLOCK_SIZE = 1ull << 22;
+};
+
+//* everything lives in arena, which must outlive the stream (a scratch scope around the processing loop is enough)
+FileStream* stream_open(Arena& arena, string path, u64 block_size = FileStream::DEFAULT_BLOCK_SIZE);
+//* consumed : bytes of the current block the caller is done with, the rest is carried over at the start of the next block
+//* returns an empty buffer once the file and the carried over tail are exhausted
+ROBuffer stream_next(FileStream& stream, u64 consumed);
+void stream_close(FileStream& stream);
+
+//* calls on_record for every delimited record, the last one might not be terminated by the delimiter
+//! records must fit in a block
+template<typename F> void stream_records(FileStream& stream, byte delimiter, F on_record) {
+	u64 consumed = 0;
+	for (auto block = stream_next(stream, 0); block.size() > 0; block = stream_next(stream, consumed)) {
+		consumed = 0;
+		for (
+			auto found = (const byte*)memchr(block.data(), delimiter, block.size());
+			found != null;
+			found = (const byte*)memchr(found + 1, delimiter, block.data() + block.size() - (found + 1))
+			) {
+			u64 end = found - block.data();
+			on_record(block.subspan(consumed, end - consumed));
+			consumed = end + 1;
+		}
+		if (stream.eof && consumed < block.size()) {
+			on_record(block.subspan(consumed));
+			consumed = block.size();
+		}
+	}
+}
+
+#ifdef BLBLSTD_IMPL
+
+#include <errno.h>
+#include <string.h>
+#if defined(PLATFORM_LINUX) || defined(PLATFORM_ANDROID)
+#include <fcntl.h>
+#endif
+
+void stream_worker(FileStream* stream) {
+	while (true) {
+		stream->requested.acquire();
+		if (stream->closing)
+			return;
+		auto target = 1 - stream->front;
+		auto block = stream->blocks[target].subspan(stream->block_size);
+		stream->filled[target] = fread(block.data(), 1, block.size(), stream->file);
+		stream->ready.release();
+	}
+}
+
+void stream_request(FileStream& stream) {
+	stream.pending = true;
+	stream.requested.release();
+}
+
+FileStream* stream_open(Arena& arena, string path, u64 block_size) {
+	auto file = fopen(path.data(), "rb");
+	if (file == null)
+		return fail_ret(strerror(errno), null);
+	setvbuf(file, null, _IONBF, 0);//* blocks are big enough, stdio buffering would only add a copy
+#if defined(PLATFORM_LINUX) || defined(PLATFORM_ANDROID)
+	posix_fadvise(fileno(file), 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+	auto stream = new (&arena.push<FileStream>()) FileStream{};
+	stream->file = file;
+	stream->block_size = block_size;
+	for (auto& block : stream->blocks)
+		block = arena.push_bytes(block_size * 2, Arena::PAGE_SIZE_HEURISTIC);
+	stream->worker = std::thread(stream_worker, stream);
+	stream_request(*stream);
+	return stream;
+}
+
+ROBuffer stream_next(FileStream& stream, u64 consumed) {
+	assert(consumed <= stream.current.size());
+	auto leftover = stream.current.subspan(consumed);
+	if (stream.eof)
+		return stream.current = {};
+	assert(leftover.size() <= stream.block_size);//! record bigger than a block
+
+	stream.ready.acquire();
+	stream.pending = false;
+	auto back = 1 - stream.front;
+	auto start = stream.block_size - leftover.size();
+	auto filled = stream.filled[back];
+	memcpy(stream.blocks[back].data() + start, leftover.data(), leftover.size());
+	stream.front = back;
+
+	if (filled == 0)
+		stream.eof = true;
+	else
+		stream_request(stream);//* previous front is free now that its tail has been moved
+	return stream.current = stream.blocks[back].subspan(start, leftover.size() + filled);
+}
+
+void stream_close(FileStream& stream) {
+	if (stream.pending)
+		stream.ready.acquire();
+	stream.closing = true;
+	stream.requested.release();
+	stream.worker.join();
+	fclose(stream.file);
+	stream.~FileStream();
+}
+
+#endif
+
+#endif
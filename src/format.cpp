@@ -0,0 +1,219 @@
+#ifndef G_FORMAT
+# define G_FORMAT
+
+#include <arena.cpp>
+#include <charconv>
+#include <concepts>
+#include <type_traits>
+
+//* {} placeholders with an optional spec {:[0][width][.precision][x|X|b]}, {{ and }} escape braces
+//* format strings are parsed at compile time, a placeholder count mismatch or a malformed spec doesn't compile
+struct FormatSpec {
+	u16 literal_begin = 0;//* literal text preceding the placeholder
+	u16 literal_end = 0;
+	bool escaped = false;//* literal contains {{ or }}
+	bool zero_fill = false;
+	bool upper = false;
+	u8 base = 10;
+	u16 width = 0;
+	i16 precision = -1;
+};
+
+void format_string_error(cstrp message);//* never defined, calling it from the consteval parser is the compile error
+
+template<typename... Args> struct format_string {
+	string str;
+	FormatSpec pieces[sizeof...(Args) + 1];//* last piece is the trailing literal
+
+	template<usize S> consteval format_string(const char(&fmt)[S]) : str(fmt, S - 1), pieces{} {
+		u64 piece = 0;
+		u64 i = 0;
+		pieces[0].literal_begin = 0;
+		while (i < str.size()) {
+			if ((str[i] == '{' || str[i] == '}') && i + 1 < str.size() && str[i + 1] == str[i]) {
+				pieces[piece].escaped = true;
+				i += 2;
+			} else if (str[i] == '}') {
+				format_string_error("unmatched } in format string");
+			} else if (str[i] == '{') {
+				if (piece >= sizeof...(Args))
+					format_string_error("more placeholders than arguments");
+				auto& spec = pieces[piece];
+				spec.literal_end = i++;
+				if (i < str.size() && str[i] == ':') {
+					i++;
+					if (i < str.size() && str[i] == '0') {
+						spec.zero_fill = true;
+						i++;
+					}
+					for (; i < str.size() && str[i] >= '0' && str[i] <= '9'; i++)
+						spec.width = spec.width * 10 + (str[i] - '0');
+					if (i < str.size() && str[i] == '.') {
+						spec.precision = 0;
+						for (i++; i < str.size() && str[i] >= '0' && str[i] <= '9'; i++)
+							spec.precision = spec.precision * 10 + (str[i] - '0');
+					}
+					if (i < str.size() && (str[i] == 'x' || str[i] == 'X')) {
+						spec.base = 16;
+						spec.upper = str[i++] == 'X';
+					} else if (i < str.size() && str[i] == 'b') {
+						spec.base = 2;
+						i++;
+					}
+				}
+				if (i >= str.size() || str[i] != '}')
+					format_string_error("malformed placeholder");
+				pieces[++piece].literal_begin = ++i;
+			} else {
+				i++;
+			}
+		}
+		if (piece != sizeof...(Args))
+			format_string_error("fewer placeholders than arguments");
+		pieces[piece].literal_end = str.size();
+	}
+};
+
+//* appends into an arena buffer, growing it through morph, which stays in place as long as it's the tip
+struct FormatWriter {
+	Arena& arena;
+	Buffer buffer;
+	u64 cursor = 0;
+
+	inline mutcstrp reserve(u64 size) {
+		if (cursor + size > buffer.size())
+			buffer = arena.morph(buffer, max(buffer.size() * 2, cursor + size), 1);
+		if (cursor + size > buffer.size())
+			return null;//* morph failed under ALLOW_FAILURE
+		return (mutcstrp)buffer.data() + cursor;
+	}
+
+	inline void write(string str) {
+		auto dest = reserve(str.size());
+		if (dest == null) return;
+		memcpy(dest, str.data(), str.size());
+		cursor += str.size();
+	}
+
+	inline void write(char c) {
+		auto dest = reserve(1);
+		if (dest == null) return;
+		*dest = c;
+		cursor++;
+	}
+
+	//* right aligns what has been written since start
+	void pad(u64 start, FormatSpec spec) {
+		auto written = cursor - start;
+		if (written >= spec.width || reserve(spec.width - written) == null)
+			return;
+		auto text = (mutcstrp)buffer.data() + start;
+		auto fill = spec.width - written;
+		auto sign = (spec.zero_fill && written > 0 && text[0] == '-') ? 1 : 0;//* zeroes go after the sign
+		memmove(text + sign + fill, text + sign, written - sign);
+		memset(text + sign, spec.zero_fill ? '0' : ' ', fill);
+		cursor += fill;
+	}
+};
+
+inline u64 format_size_hint(string str) { return str.size(); }
+inline u64 format_size_hint(cstrp str) { return str ? strlen(str) : 6; }
+inline u64 format_size_hint(bool) { return 5; }
+inline u64 format_size_hint(const std::integral auto&) { return 24; }
+inline u64 format_size_hint(const std::floating_point auto&) { return 32; }
+inline u64 format_size_hint(const any*) { return 18; }
+template<typename T> u64 format_size_hint(Array<T> arr) {
+	u64 hint = 2 + 2 * arr.size();
+	for (auto&& e : arr)
+		hint += format_size_hint(e);
+	return hint;
+}
+template<typename N> u64 format_size_hint(num_range<N> range) { return 2 + format_size_hint(range.min) + format_size_hint(range.max); }
+inline u64 format_size_hint(const auto&) { return 16; }
+
+inline void format_value(FormatWriter& out, string str, FormatSpec spec) {
+	auto start = out.cursor;
+	out.write(str);
+	out.pad(start, spec);
+}
+
+inline void format_value(FormatWriter& out, cstrp str, FormatSpec spec) { format_value(out, string(str ? str : "(null)"), spec); }
+inline void format_value(FormatWriter& out, bool value, FormatSpec spec) { format_value(out, string(value ? "true" : "false"), spec); }
+inline void format_value(FormatWriter& out, char value, FormatSpec spec) { format_value(out, string(&value, 1), spec); }
+
+template<std::integral T> void format_value(FormatWriter& out, T value, FormatSpec spec) {
+	auto start = out.cursor;
+	constexpr u64 MAX_DIGITS = sizeof(T) * 8 + 1;
+	auto dest = out.reserve(MAX_DIGITS);
+	if (dest == null) return;
+	auto end = std::to_chars(dest, dest + MAX_DIGITS, value, spec.base).ptr;
+	if (spec.upper) for (auto it = dest; it < end; it++)
+		if (*it >= 'a' && *it <= 'f') *it -= 'a' - 'A';
+	out.cursor += end - dest;
+	out.pad(start, spec);
+}
+
+template<std::floating_point T> void format_value(FormatWriter& out, T value, FormatSpec spec) {
+	auto start = out.cursor;
+	for (u64 size = 32 + max(spec.precision, i16(0));; size *= 2) {
+		auto dest = out.reserve(size);
+		if (dest == null) return;
+		auto [end, error] = spec.precision < 0 ?
+			std::to_chars(dest, dest + size, value) ://* shortest round trip
+			std::to_chars(dest, dest + size, value, std::chars_format::fixed, spec.precision);
+		if (error == std::errc{}) {
+			out.cursor += end - dest;
+			break;
+		}
+	}
+	out.pad(start, spec);
+}
+
+inline void format_value(FormatWriter& out, const any* ptr, FormatSpec spec) {
+	out.write("0x");
+	format_value(out, uintptr_t(ptr), FormatSpec{ .zero_fill = spec.zero_fill, .upper = spec.upper, .base = 16, .width = spec.width });
+}
+
+//* spec applies to each element
+template<typename T> void format_value(FormatWriter& out, Array<T> arr, FormatSpec spec) {
+	out.write('[');
+	for (auto i : u64xrange{ 0, arr.size() }) {
+		if (i > 0) out.write(string(", "));
+		format_value(out, arr[i], spec);
+	}
+	out.write(']');
+}
+
+template<typename N> void format_value(FormatWriter& out, num_range<N> range, FormatSpec spec) {
+	format_value(out, range.min, spec);
+	out.write(string(".."));
+	format_value(out, range.max, spec);
+}
+
+template<typename... Args> void format_to(FormatWriter& out, std::type_identity_t<format_string<Args...>> fmt, const Args&... args) {
+	auto write_literal = [&](const FormatSpec& piece) {
+		auto literal = fmt.str.substr(piece.literal_begin, piece.literal_end - piece.literal_begin);
+		if (!piece.escaped)
+			return out.write(literal);
+		for (u64 i = 0; i < literal.size(); i++) {
+			out.write(literal[i]);
+			if ((literal[i] == '{' || literal[i] == '}') && i + 1 < literal.size() && literal[i + 1] == literal[i])
+				i++;
+		}
+	};
+	u64 index = 0;
+	((write_literal(fmt.pieces[index]), format_value(out, args, fmt.pieces[index]), index++), ...);
+	write_literal(fmt.pieces[index]);
+}
+
+//* single pass, sized from a per argument upper bound estimate so it almost never grows, then shrunk in place
+template<typename... Args> string format(Arena& arena, std::type_identity_t<format_string<Args...>> fmt, const Args&... args) {
+	u64 hint = fmt.str.size() + 1 + (format_size_hint(args) + ... + 0);
+	FormatWriter out = { arena, arena.push_bytes(hint, 1) };
+	format_to<Args...>(out, fmt, args...);
+	out.write('\0');
+	auto str = arena.morph(out.buffer, out.cursor, 1);
+	return string((cstrp)str.data(), max(out.cursor, 1ull) - 1);
+}
+
+#endif
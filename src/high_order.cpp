@@ -6,6 +6,13 @@
 #include <link_list.cpp>
 #include <concepts>
 #include <arena.cpp>
+#include <scratch.cpp>
+#include <parallel.cpp>
+#include <utility>
+#include <barrier>
+#include <algorithm>
+#include <functional>
+#include <string.h>
 
 template<typename S> struct signature {
 	using r = void;
@@ -51,26 +58,76 @@ template<typename T> auto map(Arena& arena, Array<T> collection, auto mapper) {
 
 template<typename T, typename R> auto map(Array<R> buff, Array<T> collection, auto mapper) {
 	// using R = decltype(mapper(collection[0]));
-	auto arena = Arena::from_array(buff);
+	auto arena = FixedArena::from_array(buff);
 	auto list = List{ arena.template push_array<R>(collection.size()), 0 };
 	for (auto&& i : collection)
 		list.push(mapper(i));
 	return list.used();
 }
 
+//* index of the first highest/lowest element, reduced over independent lanes so it vectorizes, then located with vector_search
+//* NaNs never compare better so they are skipped, the lanes start from the first element that isn't one, -1 when they all are
+template<typename T, bool highest> i64 arg_extreme(Array<T> collection) {
+	using E = std::remove_cv_t<T>;
+	constexpr u64 LANES = 32 / sizeof(E);
+	auto better = [](E a, E b) { return highest ? a > b : a < b; };
+	u64 i = 0;
+	while (i < collection.size() && collection[i] != collection[i])
+		i++;
+	if (i == collection.size())
+		return -1;
+	E lanes[LANES];
+	for (auto& l : lanes)
+		l = collection[i];
+	for (; i + LANES <= collection.size(); i += LANES) for (auto l : u64xrange{ 0, LANES })
+		lanes[l] = better(collection[i + l], lanes[l]) ? collection[i + l] : lanes[l];
+	E best = lanes[0];
+	for (auto l : lanes)
+		best = better(l, best) ? l : best;
+	for (; i < collection.size(); i++)
+		best = better(collection[i], best) ? collection[i] : best;
+	return vector_search<E>(collection.data(), collection.size(), best, best);
+}
+
+template<typename T> requires simd_element<std::remove_cv_t<T>> i64 arg_max(Array<T> collection) { return arg_extreme<T, true>(collection); }
+template<typename T> requires simd_element<std::remove_cv_t<T>> i64 arg_min(Array<T> collection) { return arg_extreme<T, false>(collection); }
+
+//* arithmetic scores are evaluated a chunk at a time into a local buffer so the comparisons vectorize through arg_max
+//* picks the same as the scalar loop : the first score no later one beats, so a NaN first score is kept & later NaNs are skipped
 template<typename T> i64 best_fit_search(Array<T> collection, auto score) {
 	if (collection.size() == 0)
 		return -1;
-	auto s = score(collection[0]);
-	auto index = 0;
-	for (auto i : i64xrange{ 0, collection.size() }) {
-		auto si = score(collection[i]);
-		if (si > s) {
-			s = si;
-			index = i;
+	using S = decltype(score(collection[0]));
+	if constexpr (simd_element<S>) {
+		constexpr u64 CHUNK = 256;
+		S scores[CHUNK];
+		S best = {};
+		i64 index = 0;
+		for (u64 start = 0; start < collection.size(); start += CHUNK) {
+			auto count = min(CHUNK, collection.size() - start);
+			for (auto i : u64xrange{ 0, count })
+				scores[i] = score(collection[start + i]);
+			if (start == 0)
+				best = scores[0];
+			auto chunk_best = arg_max(carray(scores, count));
+			if (chunk_best >= 0 && scores[chunk_best] > best) {
+				best = scores[chunk_best];
+				index = start + chunk_best;
+			}
+		}
+		return index;
+	} else {
+		auto s = score(collection[0]);
+		i64 index = 0;
+		for (auto i : i64xrange{ 1, i64(collection.size()) }) {
+			auto si = score(collection[i]);
+			if (si > s) {
+				s = si;
+				index = i;
+			}
 		}
+		return index;
 	}
-	return index;
 }
 
 template<typename T> T fit_highest(const T& t) { return t;}
@@ -105,6 +162,255 @@ template<typename T> Array<T> sort(Arena& arena, Array<T> collection, auto comp)
 	return sorted.used();
 }
 
+//* binary max heap in place, less orders the elements, the greatest ends up at the root
+template<typename T> void sift_down(Array<T> heap, u64 index, auto less) {
+	auto element = std::move(heap[index]);
+	while (true) {
+		auto child = 2 * index + 1;
+		if (child >= heap.size())
+			break;
+		if (child + 1 < heap.size() && less(heap[child], heap[child + 1]))
+			child++;
+		if (!less(element, heap[child]))
+			break;
+		heap[index] = std::move(heap[child]);
+		index = child;
+	}
+	heap[index] = std::move(element);
+}
+
+template<typename T> Array<T> make_heap(Array<T> heap, auto less) {
+	for (auto i = heap.size() / 2; i-- > 0;)
+		sift_down(heap, i, less);
+	return heap;
+}
+
+//* turns a heap into an array sorted by less
+template<typename T> Array<T> sort_heap(Array<T> heap, auto less) {
+	for (auto end = heap.size(); end > 1; end--) {
+		std::swap(heap[0], heap[end - 1]);
+		sift_down(heap.subspan(0, end - 1), 0, less);
+	}
+	return heap;
+}
+
+//* introselect : afterward collection[n] is the element a sort would put there, with nothing greater before it & nothing less after it
+//* quickselect on a median of 3 pivot, falling back to a heap select when partitions keep being bad
+template<typename T> Array<T> nth_element(Array<T> collection, u64 n, auto less) {
+	if (n >= collection.size())
+		return collection;
+	auto range = collection;
+	u64 depth = 2 * (64 - __builtin_clzll(collection.size()));
+	while (range.size() > 16 && depth-- > 0) {
+		auto& a = range[0];
+		auto& b = range[range.size() / 2];
+		auto& c = range[range.size() - 1];
+		if (less(b, a)) std::swap(a, b);
+		if (less(c, b)) std::swap(b, c);
+		if (less(b, a)) std::swap(a, b);
+		auto pivot = b;
+		u64 i = 0;
+		u64 j = range.size() - 1;
+		while (true) {//* hoare partition, the median of 3 guards both scans
+			while (less(range[i], pivot)) i++;
+			while (less(pivot, range[j])) j--;
+			if (i >= j) break;
+			std::swap(range[i++], range[j--]);
+		}
+		if (n <= j) {
+			range = range.subspan(0, j + 1);
+		} else {
+			range = range.subspan(j + 1);
+			n -= j + 1;
+		}
+	}
+	if (range.size() <= 16) {//* insertion sort
+		for (auto i : u64xrange{ 1, range.size() }) for (auto j = i; j > 0 && less(range[j], range[j - 1]); j--)
+			std::swap(range[j], range[j - 1]);
+	} else {//* heap select : keep the n + 1 least in a max heap, its root is the answer
+		auto heap = make_heap(range.subspan(0, n + 1), less);
+		for (auto i : u64xrange{ n + 1, range.size() }) if (less(range[i], heap[0])) {
+			std::swap(range[i], heap[0]);
+			sift_down(heap, 0, less);
+		}
+		std::swap(heap[0], heap[n]);
+	}
+	return collection;
+}
+
+//* indices of the k best scores, best first, ties go to the lowest index
+//* bounded heap when k is small against the collection, introselect over every candidate otherwise
+template<typename T> Array<u64> best_k(Arena& arena, Array<T> collection, u64 k, auto score) {
+	using S = decltype(score(collection[0]));
+	struct Candidate {
+		S score;
+		u64 index;
+	};
+	auto before = [](const Candidate& a, const Candidate& b) { return a.score > b.score || (a.score == b.score && a.index < b.index); };
+
+	k = min(k, collection.size());
+	auto result = arena.push_array<u64>(k);
+	if (k == 0)
+		return result;
+	auto [scratch, scope] = scratch_push_scope(0, &arena); defer{ scratch_pop_scope(scratch, scope); };
+
+	Array<Candidate> top;
+	if (k * 8 < collection.size()) {
+		top = scratch.push_array<Candidate>(k);
+		for (auto i : u64xrange{ 0, k })
+			top[i] = { score(collection[i]), i };
+		make_heap(top, before);//* root is the worst kept candidate
+		for (auto i : u64xrange{ k, collection.size() }) {
+			Candidate candidate = { score(collection[i]), i };
+			if (before(candidate, top[0])) {
+				top[0] = candidate;
+				sift_down(top, 0, before);
+			}
+		}
+	} else {
+		top = scratch.push_array<Candidate>(collection.size());
+		for (auto i : u64xrange{ 0, collection.size() })
+			top[i] = { score(collection[i]), i };
+		top = nth_element(top, k - 1, before).subspan(0, k);
+		make_heap(top, before);
+	}
+	sort_heap(top, before);
+	for (auto i : u64xrange{ 0, k })
+		result[i] = top[i].index;
+	return result;
+}
+
+//* stable, one output push : the elements matching pred first, then the others
+template<typename T> tuple<Array<T>, Array<T>> partition(Arena& arena, Array<const T> collection, auto pred) {
+	auto result = arena.push_array<T>(collection.size());
+	u64 front = 0;
+	u64 back = collection.size();
+	for (auto&& e : collection) if (pred(e))
+		result[front++] = e;
+	else
+		result[--back] = e;
+	std::reverse(result.begin() + back, result.end());
+	return { result.subspan(0, front), result.subspan(front) };
+}
+
+template<typename T> tuple<Array<T>, Array<T>> partition(Arena& arena, Array<T> collection, auto pred) { return partition(arena, Array<const T>(collection), pred); }
+
+//* bucket(e) must be in [0, bucket_count)
+template<typename T> Array<u64> histogram(Arena& arena, Array<T> collection, auto bucket, u64 bucket_count) {
+	auto counts = arena.push_array<u64>(bucket_count, true);
+	for (auto&& e : collection) {
+		u64 b = bucket(e);
+		assert(b < bucket_count);
+		counts[b]++;
+	}
+	return counts;
+}
+
+//* elements sorted by group, group i is elements[offsets[i], offsets[i + 1])
+template<typename T> struct Groups {
+	Array<T> elements;
+	Array<u64> offsets;
+
+	inline u64 size() const { return offsets.size() - 1; }
+	inline Array<T> operator[](u64 group) const { return elements.subspan(offsets[group], offsets[group + 1] - offsets[group]); }
+};
+
+//* counting sort on key(e) in [0, group_count) : a histogram pass then a stable scatter
+template<typename T> Groups<std::remove_cv_t<T>> group_by(Arena& arena, Array<T> collection, auto key, u64 group_count) {
+	using E = std::remove_cv_t<T>;
+	auto offsets = arena.push_array<u64>(group_count + 1);
+	auto elements = arena.push_array<E>(collection.size());
+	auto [scratch, scope] = scratch_push_scope(0, &arena); defer{ scratch_pop_scope(scratch, scope); };
+	auto cursors = histogram(scratch, collection, key, group_count);
+	u64 total = 0;
+	for (auto g : u64xrange{ 0, group_count }) {
+		offsets[g] = total;
+		total += std::exchange(cursors[g], total);
+	}
+	offsets[group_count] = total;
+	for (auto&& e : collection)
+		elements[cursors[key(e)]++] = e;
+	return { elements, offsets };
+}
+
+//* same result as group_by, every thread histograms its chunk & scatters it once all histograms are known
+//* a thread's slots in a group start after the same group's slots of the threads before it, which keeps the sort stable
+//* the histograms are pushed on arena by the calling thread after the result & popped before returning
+template<typename T> Groups<std::remove_cv_t<T>> group_by_parallel(Arena& arena, Array<T> collection, auto key, u64 group_count, u32 threads = hardware_threads()) {
+	using E = std::remove_cv_t<T>;
+	constexpr u32 MAX_THREADS = 256;
+	threads = min(max(threads, 1u), MAX_THREADS);
+	auto offsets = arena.push_array<u64>(group_count + 1);
+	auto elements = arena.push_array<E>(collection.size());
+	auto scope = arena.scope();
+	auto counts = arena.push_array<u64>(u64(threads) * group_count, true);
+	auto all_cursors = arena.push_array<u64>(u64(threads) * group_count);
+	std::barrier sync(threads);
+	parallel_for(threads, [&](u32 index, u32 count) {
+		auto chunk = collection.subspan(collection.size() * index / count, collection.size() * (index + 1) / count - collection.size() * index / count);
+		auto histogram = counts.subspan(u64(index) * group_count, group_count);
+		for (auto&& e : chunk) {
+			u64 g = key(e);
+			assert(g < group_count);//* the slices are contiguous, a bad key would land in another thread's histogram
+			histogram[g]++;
+		}
+		sync.arrive_and_wait();
+		auto cursors = all_cursors.subspan(u64(index) * group_count, group_count);
+		u64 total = 0;
+		for (auto g : u64xrange{ 0, group_count }) {
+			if (index == 0)
+				offsets[g] = total;
+			for (auto t : u32xrange{ 0, count }) {
+				if (t == index)
+					cursors[g] = total;
+				total += counts[u64(t) * group_count + g];
+			}
+		}
+		if (index == 0)
+			offsets[group_count] = total;
+		for (auto&& e : chunk)
+			elements[cursors[key(e)]++] = e;
+	});
+	arena.pop_to(scope);
+	return { elements, offsets };
+}
+
+//* mapper gets one element of each zipped array, blocks of W elements give the compiler constant trip counts to vectorize
+template<u64 W = 8, typename... T> auto zip_map(Arena& arena, zip_range<T...> zipped, auto mapper) {
+	using R = decltype(std::apply(mapper, zipped[0]));
+	auto result = arena.push_array<R>(zipped.size());
+	u64 i = 0;
+	for (auto block : zipped.template batched<W>()) {
+		for (auto k : u64xrange{ 0, W })
+			result[i + k] = std::apply([&](auto... b) { return mapper(b[k]...); }, block);
+		i += W;
+	}
+	for (auto&& e : zipped.template tail<W>())
+		result[i++] = std::apply(mapper, e);
+	return result;
+}
+
+//* sequential fold, acc(result, elements...)
+template<typename R, typename... T> R zip_fold(const R& init, zip_range<T...> zipped, auto acc) {
+	R result = init;
+	for (auto&& e : zipped)
+		result = std::apply([&](auto&... elements) { return acc(result, elements...); }, e);
+	return result;
+}
+
+//* W independent lanes merged with combine at the end, so acc must be associative & identity neutral for it
+template<u64 W = 8, typename R, typename... T> R zip_fold(const R& identity, zip_range<T...> zipped, auto acc, auto combine) {
+	R lanes[W];
+	for (auto& l : lanes)
+		l = identity;
+	for (auto block : zipped.template batched<W>()) for (auto k : u64xrange{ 0, W })
+		lanes[k] = std::apply([&](auto... b) { return acc(lanes[k], b[k]...); }, block);
+	R result = zip_fold(identity, zipped.template tail<W>(), acc);
+	for (auto& l : lanes)
+		result = combine(result, l);
+	return result;
+}
+
 template<typename R, typename T> R fold(const R& init, Array<T> collection, auto acc) {
 	R result = init;
 	for (auto&& e : collection)
@@ -112,4 +418,112 @@ template<typename R, typename T> R fold(const R& init, Array<T> collection, auto
 	return result;
 }
 
+//* scans : op must be associative, std::plus over 32/64 bit integers runs the in register vector scan
+//* inclusive out[i] = in[0] op ... op in[i], exclusive out[i] = init op in[0] op ... op in[i - 1]
+//* in & out may be the same array, returns the running value after the last element
+
+template<typename T> concept simd_scannable = std::is_integral_v<T> && (sizeof(T) == 4 || sizeof(T) == 8);
+
+//* log step scan of one 16 bytes vector : x += x shifted by 1 lane, then by 2 lanes
+template<typename T> T simd_inclusive_add(const T* in, T* out, u64 count, T carry) {
+	typedef T V __attribute__((vector_size(16)));
+	constexpr u64 LANES = 16 / sizeof(T);
+	const V zero = {};
+	V running = zero + carry;
+	u64 i = 0;
+	for (; i + LANES <= count; i += LANES) {
+		V x;
+		memcpy(&x, in + i, sizeof(x));
+		if constexpr (LANES == 4) {
+			x += __builtin_shufflevector(x, zero, 4, 0, 1, 2);
+			x += __builtin_shufflevector(x, zero, 4, 5, 0, 1);
+		} else {
+			x += __builtin_shufflevector(x, zero, 2, 0);
+		}
+		x += running;
+		memcpy(out + i, &x, sizeof(x));
+		running = zero + x[LANES - 1];
+	}
+	carry = running[0];
+	for (; i < count; i++)
+		out[i] = carry = carry + in[i];
+	return carry;
+}
+
+template<typename T, typename Op> T scan_inclusive_into(const T* in, T* out, u64 count, T carry, Op op) {
+	if constexpr (simd_scannable<T> && std::is_same_v<Op, std::plus<>>) {
+		return simd_inclusive_add(in, out, count, carry);
+	} else {
+		for (auto i : u64xrange{ 0, count })
+			out[i] = carry = op(carry, in[i]);
+		return carry;
+	}
+}
+
+template<typename T, typename Op> T scan_exclusive_into(const T* in, T* out, u64 count, T carry, Op op) {
+	for (auto i : u64xrange{ 0, count }) {
+		auto value = in[i];
+		out[i] = carry;
+		carry = op(carry, value);
+	}
+	return carry;
+}
+
+//* no identity needed, the first element starts the scan
+template<typename T, typename Op = std::plus<>> Array<T> inclusive_scan(Array<T> data, Op op = {}) {
+	if (data.size() > 1)
+		scan_inclusive_into(data.data() + 1, data.data() + 1, data.size() - 1, data[0], op);
+	return data;
+}
+
+template<typename T, typename Op = std::plus<>> Array<T> inclusive_scan(Arena& arena, Array<const T> data, Op op = {}) {
+	auto out = arena.push_array<T>(data.size());
+	if (data.size() > 0) {
+		out[0] = data[0];
+		scan_inclusive_into(data.data() + 1, out.data() + 1, data.size() - 1, data[0], op);
+	}
+	return out;
+}
+
+//* returns the total
+template<typename T, typename Op = std::plus<>> T exclusive_scan(Array<T> data, std::type_identity_t<T> init = {}, Op op = {}) {
+	return scan_exclusive_into(data.data(), data.data(), data.size(), init, op);
+}
+
+//* size + 1 elements, the total last, ready to use as offsets
+template<typename T, typename Op = std::plus<>> Array<T> exclusive_scan(Arena& arena, Array<const T> data, std::type_identity_t<T> init = {}, Op op = {}) {
+	auto out = arena.push_array<T>(data.size() + 1);
+	out[data.size()] = scan_exclusive_into(data.data(), out.data(), data.size(), init, op);
+	return out;
+}
+
+//* reduce then scan : every thread folds its chunk, then scans it again starting from the fold of the chunks before it
+//* identity must be neutral for op, data is read twice & written once
+template<typename T, typename Op = std::plus<>> Array<T> inclusive_scan_parallel(Array<T> data, std::type_identity_t<T> identity = {}, Op op = {}, u32 threads = hardware_threads()) {
+	constexpr u32 MAX_THREADS = 256;
+	constexpr u64 MIN_CHUNK = 1 << 14;//* below that, threads cost more than they save
+	threads = min(max(min(u64(threads), data.size() / MIN_CHUNK), u64(1)), u64(MAX_THREADS));
+	if (threads == 1)
+		return scan_inclusive_into(data.data(), data.data(), data.size(), identity, op), data;
+	T partials[MAX_THREADS];
+	std::barrier sync(threads);
+	parallel_for(threads, [&](u32 index, u32 count) {
+		auto begin = data.size() * index / count;
+		auto chunk = data.subspan(begin, data.size() * (index + 1) / count - begin);
+		partials[index] = fold(identity, chunk, op);
+		sync.arrive_and_wait();
+		T carry = identity;
+		for (auto t : u32xrange{ 0, index })
+			carry = op(carry, partials[t]);
+		scan_inclusive_into(chunk.data(), chunk.data(), chunk.size(), carry, op);
+	});
+	return data;
+}
+
+template<typename T, typename Op = std::plus<>> Array<T> inclusive_scan_parallel(Arena& arena, Array<const T> data, std::type_identity_t<T> identity = {}, Op op = {}, u32 threads = hardware_threads()) {
+	auto out = arena.push_array<T>(data.size());
+	memcpy(out.data(), data.data(), data.size_bytes());
+	return inclusive_scan_parallel(out, identity, op, threads);
+}
+
 #endif
@@ -122,8 +122,10 @@ template<typename T, DoubleLink<T> T::* l> struct DoubleListIterator {
 
 template<typename T> T* insert_after(T* current, T* next, DoubleLink<T> T::* link) {
 	if (current != nullptr) {
-		if ((current->*link).next != nullptr)
+		if ((current->*link).next != nullptr) {
 			(next->*link).next = (current->*link).next;
+			((current->*link).next->*link).previous = next;
+		}
 		(current->*link).next = next;
 	}
 	if (next != nullptr)
@@ -133,8 +135,10 @@ template<typename T> T* insert_after(T* current, T* next, DoubleLink<T> T::* lin
 
 template<typename T> T* insert_before(T* current, T* previous, DoubleLink<T> T::* link) {
 	if (current != nullptr) {
-		if ((current->*link).previous != nullptr)
+		if ((current->*link).previous != nullptr) {
 			(previous->*link).previous = (current->*link).previous;
+			((current->*link).previous->*link).next = previous;
+		}
 		(current->*link).previous = previous;
 	}
 	if (previous != nullptr)
@@ -157,6 +161,25 @@ template<typename T> T* list_preppend(LinkList<T>& parent, T* element, DoubleLin
 	return element;
 }
 
+//* detaches element from its neighbours & clears its links
+template<typename T> T* unlink(T* element, DoubleLink<T> T::* link) {
+	auto& links = element->*link;
+	if (links.previous != nullptr)
+		(links.previous->*link).next = links.next;
+	if (links.next != nullptr)
+		(links.next->*link).previous = links.previous;
+	links = {};
+	return element;
+}
+
+template<typename T> T* list_remove(LinkList<T>& parent, T* element, DoubleLink<T> T::* link) {
+	if (parent.first == element)
+		parent.first = (element->*link).next;
+	if (parent.last == element)
+		parent.last = (element->*link).previous;
+	return unlink(element, link);
+}
+
 template<typename T, DoubleLink<T> T::* l> bool operator!=(DoubleListIterator<T, l> a, DoubleListIterator<T, l> b) {
 	if (a.current == nullptr && b.current == nullptr) return false;
 	return a.current != b.current;
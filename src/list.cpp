@@ -45,24 +45,24 @@ template<typename T> struct List {
 		return capacity.subspan(current, count);
 	}
 
-	auto push_growing(Arena& arena, usize count) {
-		grow(arena, count);
+	auto push_growing(Arena& arena, usize count, alloc_site site = alloc_site::current()) {
+		grow(arena, count, site);
 		return push_count(count);
 	}
 
-	auto& push_growing(Arena& arena, const T& element) {
-		grow(arena);
+	auto& push_growing(Arena& arena, const T& element, alloc_site site = alloc_site::current()) {
+		grow(arena, 1, site);
 		return push(element);
 	}
 
-	u32 push_idx(Arena& arena, const T& element) {
+	u32 push_idx(Arena& arena, const T& element, alloc_site site = alloc_site::current()) {
 		u32 index = current;
-		push_growing(arena, element);
+		push_growing(arena, element, site);
 		return index;
 	}
 
-	auto push_growing(Arena& arena, Array<const T> elements) {
-		auto dest = push_growing(arena, elements.size());
+	auto push_growing(Arena& arena, Array<const T> elements, alloc_site site = alloc_site::current()) {
+		auto dest = push_growing(arena, elements.size(), site);
 		for (auto i : u64xrange{ 0, elements.size() })
 			dest[i] = elements[i];
 		return dest;
@@ -111,9 +111,9 @@ template<typename T> struct List {
 		}
 	}
 
-	bool grow(Arena& arena, u32 intended_pushes = 1) {
+	bool grow(Arena& arena, u32 intended_pushes = 1, alloc_site site = alloc_site::current()) {
 		if (current + intended_pushes > capacity.size()) {
-			capacity = arena.morph_array(capacity, max(max(1ull, capacity.size()) * 2, max(1ull, capacity.size()) + intended_pushes));
+			capacity = arena.morph_array(capacity, max(max(1ull, capacity.size()) * 2, max(1ull, capacity.size()) + intended_pushes), site);
 			//TODO error handling upon realloc failure
 			return true;
 		} else return false;
@@ -136,8 +136,8 @@ template<typename T> struct List {
 		return tmp;
 	}
 
-	auto& swap_in_growing(Arena& arena, usize index, const T& element) {
-		grow(arena);
+	auto& swap_in_growing(Arena& arena, usize index, const T& element, alloc_site site = alloc_site::current()) {
+		grow(arena, 1, site);
 		return swap_in(index, element);
 	}
 
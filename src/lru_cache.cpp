@@ -0,0 +1,242 @@
+#ifndef G_LRU_CACHE
+# define G_LRU_CACHE
+
+#include <utils.cpp>
+#include <memory.cpp>
+#include <link_list.cpp>
+#include <arena.cpp>
+#include <type_traits>
+#include <mutex>
+
+template<typename K> inline u64 default_hash(const K& key) {
+	if constexpr (std::is_integral_v<K> || std::is_enum_v<K> || std::is_pointer_v<K>)
+		return hash_mix(u64(key));
+	else if constexpr (std::is_convertible_v<const K&, string>) {
+		string str = key;
+		return hash_bytes(ROBuffer((const byte*)str.data(), str.size()));
+	} else {
+		static_assert(std::has_unique_object_representations_v<K>, "provide a hash for keys with padding or indirections");
+		return hash_bytes(ROBuffer((const byte*)&key, sizeof(K)));
+	}
+}
+
+template<typename K> struct DefaultHash {
+	inline u64 operator()(const K& key) const { return default_hash(key); }
+};
+
+//* fixed capacity, nodes come from one slab pushed at creation so the cache never allocates afterwards
+//* lookups go through an open addressing index of node slots (linear probing, backward shift removal, no tombstones)
+//* order is an intrusive double list, first is the most recently used
+//* when full, the eviction_batch least recently used nodes go at once & are handed to the callback before reuse
+template<typename K, typename V, typename Hash = DefaultHash<K>> struct LruCache {
+	static constexpr u32 NONE = ~0u;
+	static constexpr u32 MAX_EVICTION_BATCH = 64;
+
+	struct Node {
+		K key;
+		V value;
+		u64 hash;
+		DoubleLink<Node> order;
+	};
+
+	Array<Node> nodes;
+	Array<u32> index;
+	LinkList<Node> order;
+	Node* free_nodes = null;//* chained through order.next
+	u32 used = 0;
+	u32 eviction_batch = 1;
+	u64 hits = 0;
+	u64 misses = 0;
+	u64 evictions = 0;
+
+	static LruCache make(Arena& arena, u32 capacity, u32 eviction_batch = 0) {
+		assert(capacity > 0);
+		LruCache cache = {};
+		cache.nodes = arena.push_array<Node>(capacity);
+		cache.index = arena.push_array<u32>(round_up_bit(u64(capacity) * 2));
+		memset(cache.index.data(), 0xff, cache.index.size_bytes());
+		cache.eviction_batch = eviction_batch ? min(eviction_batch, MAX_EVICTION_BATCH) : min(max(capacity / 16, 1u), MAX_EVICTION_BATCH);
+		cache.eviction_batch = min(cache.eviction_batch, capacity);
+		return cache;
+	}
+
+	inline u64 mask() const { return index.size() - 1; }
+	inline u64 size() const { return used; }
+	inline u64 capacity() const { return nodes.size(); }
+
+	//* slot holding key, or the empty slot where it would go
+	u64 find_slot(const K& key, u64 hash) const {
+		for (u64 i = hash & mask();; i = (i + 1) & mask()) {
+			auto n = index[i];
+			if (n == NONE || (nodes[n].hash == hash && nodes[n].key == key))
+				return i;
+		}
+	}
+
+	void remove_slot(u64 hole) {
+		for (u64 j = (hole + 1) & mask(); index[j] != NONE; j = (j + 1) & mask()) {
+			auto home = nodes[index[j]].hash & mask();
+			auto stays = hole <= j ? (hole < home && home <= j) : (hole < home || home <= j);//* home cyclically in (hole, j]
+			if (!stays) {
+				index[hole] = index[j];
+				hole = j;
+			}
+		}
+		index[hole] = NONE;
+	}
+
+	inline void touch(Node* node) {
+		if (order.first == node)
+			return;
+		list_remove(order, node, &Node::order);
+		list_preppend(order, node, &Node::order);
+	}
+
+	//* null on miss, a hit becomes the most recently used
+	V* get(const K& key) {
+		auto hash = Hash{}(key);
+		auto n = index[find_slot(key, hash)];
+		if (n == NONE) {
+			misses++;
+			return null;
+		}
+		hits++;
+		touch(&nodes[n]);
+		return &nodes[n].value;
+	}
+
+	//* on_evict(Array<Node* const>) sees the evicted nodes before they are reused
+	template<typename F> void evict(F on_evict) {
+		Node* evicted[MAX_EVICTION_BATCH];
+		u32 count = 0;
+		while (count < eviction_batch && order.last) {
+			auto node = list_remove(order, order.last, &Node::order);
+			remove_slot(find_slot(node->key, node->hash));
+			evicted[count++] = node;
+		}
+		on_evict(Array<Node* const>(evicted, count));
+		for (auto node : Array<Node* const>(evicted, count)) {
+			node->order.next = free_nodes;
+			free_nodes = node;
+		}
+		used -= count;
+		evictions += count;
+	}
+
+	template<typename F> V& put(const K& key, const V& value, F on_evict) {
+		auto hash = Hash{}(key);
+		auto slot = find_slot(key, hash);
+		if (index[slot] != NONE) {
+			auto& node = nodes[index[slot]];
+			node.value = value;
+			touch(&node);
+			return node.value;
+		}
+		if (used == nodes.size()) {
+			evict(on_evict);
+			slot = find_slot(key, hash);//* removals shifted the index
+		}
+		Node* node;
+		if (free_nodes) {
+			node = free_nodes;
+			free_nodes = node->order.next;
+		} else {
+			node = &nodes[used];
+		}
+		*node = { key, value, hash, {} };
+		index[slot] = node - nodes.data();
+		list_preppend(order, node, &Node::order);
+		used++;
+		return node->value;
+	}
+
+	inline V& put(const K& key, const V& value) { return put(key, value, [](Array<Node* const>) {}); }
+
+	bool erase(const K& key) {
+		auto slot = find_slot(key, Hash{}(key));
+		if (index[slot] == NONE)
+			return false;
+		auto node = &nodes[index[slot]];
+		remove_slot(slot);
+		list_remove(order, node, &Node::order);
+		node->order.next = free_nodes;
+		free_nodes = node;
+		used--;
+		return true;
+	}
+
+	template<typename C, typename F> V& get_or_compute(const K& key, C compute, F on_evict) {
+		if (auto found = get(key))
+			return *found;
+		return put(key, compute(key), on_evict);
+	}
+
+	template<typename C> V& get_or_compute(const K& key, C compute) { return get_or_compute(key, compute, [](Array<Node* const>) {}); }
+};
+
+//* one lock per shard, picked with the high hash bits while the shard's index uses the low ones
+//* values are copied out since a pointer would outlive the lock, computes run outside of it
+template<typename K, typename V, u32 S = 16, typename Hash = DefaultHash<K>> struct ShardedLruCache {
+	struct alignas(64) Shard {
+		std::mutex lock;
+		LruCache<K, V, Hash> cache;
+	};
+
+	Shard shards[S];
+
+	//* capacity is split evenly among the shards
+	static ShardedLruCache* make(Arena& arena, u32 capacity, u32 eviction_batch = 0) {
+		auto& sharded = *new (&arena.push<ShardedLruCache>()) ShardedLruCache{};
+		for (auto& shard : sharded.shards)
+			shard.cache = LruCache<K, V, Hash>::make(arena, max((capacity + S - 1) / S, 1u), eviction_batch);
+		return &sharded;
+	}
+
+	inline Shard& shard_of(const K& key) { return shards[(Hash{}(key) >> 48) % S]; }
+
+	bool get(const K& key, V& out) {
+		auto& shard = shard_of(key);
+		std::lock_guard guard(shard.lock);
+		auto found = shard.cache.get(key);
+		if (found)
+			out = *found;
+		return found != null;
+	}
+
+	template<typename F> void put(const K& key, const V& value, F on_evict) {
+		auto& shard = shard_of(key);
+		std::lock_guard guard(shard.lock);
+		shard.cache.put(key, value, on_evict);
+	}
+
+	inline void put(const K& key, const V& value) { put(key, value, [](auto) {}); }
+
+	bool erase(const K& key) {
+		auto& shard = shard_of(key);
+		std::lock_guard guard(shard.lock);
+		return shard.cache.erase(key);
+	}
+
+	template<typename C> V get_or_compute(const K& key, C compute) {
+		V value;
+		if (get(key, value))
+			return value;
+		value = compute(key);
+		put(key, value);
+		return value;
+	}
+
+	//* hits, misses, evictions summed over the shards
+	tuple<u64, u64, u64> stats() {
+		u64 hits = 0, misses = 0, evictions = 0;
+		for (auto& shard : shards) {
+			std::lock_guard guard(shard.lock);
+			hits += shard.cache.hits;
+			misses += shard.cache.misses;
+			evictions += shard.cache.evictions;
+		}
+		return { hits, misses, evictions };
+	}
+};
+
+#endif
@@ -2,7 +2,9 @@
 # define G_MEMORY
 
 #include <utils.cpp>
+#include <profiler.cpp>
 #include <stdlib.h>
+#include <string.h>
 
 using Buffer = Array<byte>;
 using ROBuffer = Array<const byte>;
@@ -11,13 +13,13 @@ using AllocStrat = Buffer(*)(any*, Buffer, usize, u64);
 struct Alloc {
 	any* context;
 	AllocStrat strategy;
-	inline Buffer alloc(usize size, u64 flags = 0) { return strategy(context, {}, size, flags); }
+	inline Buffer alloc(usize size, u64 flags = 0, alloc_site site = alloc_site::current()) { return (profile_alloc(site, size), strategy(context, {}, size, flags)); }
 	inline Buffer realloc(Buffer buffer, usize size, u64 flags = 0) { return strategy(context, buffer, size, flags); }
 	inline void dealloc(Buffer buffer, u64 flags = 0) { strategy(context, buffer, 0, flags); }
 };
 
-template<typename T> inline Array<T> alloc_array(Alloc allocator, usize count, u64 flags = 0) {
-	return cast<T>(allocator.alloc(sizeof(T) * count, flags));
+template<typename T> inline Array<T> alloc_array(Alloc allocator, usize count, u64 flags = 0, alloc_site site = alloc_site::current()) {
+	return cast<T>(allocator.alloc(sizeof(T) * count, flags, site));
 }
 
 template<typename T> inline Array<T> realloc_array(Alloc allocator, Array<T> arr, usize count, u64 flags = 0) {
@@ -28,29 +30,29 @@ template<typename T> inline void dealloc_array(Alloc allocator, Array<T> arr, u6
 	return allocator.dealloc(cast<byte>(arr), flags);
 }
 
-template<typename T> inline Array<T> duplicate_array(Alloc allocator, Array<T> arr, u64 flags = 0) {
-	auto other = alloc_array<T>(allocator, arr.size(), flags);
+template<typename T> inline Array<T> duplicate_array(Alloc allocator, Array<T> arr, u64 flags = 0, alloc_site site = alloc_site::current()) {
+	auto other = alloc_array<T>(allocator, arr.size(), flags, site);
 	memcpy(other.data(), arr.data(), arr.size_bytes());
 	return other;
 }
 
-template<typename T> inline Array<T> duplicate_array(Alloc allocator, Array<const T> arr, u64 flags = 0) {
-	auto other = alloc_array<T>(allocator, arr.size(), flags);
+template<typename T> inline Array<T> duplicate_array(Alloc allocator, Array<const T> arr, u64 flags = 0, alloc_site site = alloc_site::current()) {
+	auto other = alloc_array<T>(allocator, arr.size(), flags, site);
 	memcpy(other.data(), arr.data(), arr.size_bytes());
 	return other;
 }
 
-template<typename T> inline Array<T> push_array(Alloc allocator, LiteralArray<T> arr, u64 flags = 0) { return duplicate_array(allocator, larray(arr), flags); }
+template<typename T> inline Array<T> push_array(Alloc allocator, LiteralArray<T> arr, u64 flags = 0, alloc_site site = alloc_site::current()) { return duplicate_array(allocator, larray(arr), flags, site); }
 
-inline string push_string(Alloc allocator, string str, u64 flags = 0) {
-	auto other = alloc_array<char>(allocator, str.size() + 1, flags);
+inline string push_string(Alloc allocator, string str, u64 flags = 0, alloc_site site = alloc_site::current()) {
+	auto other = alloc_array<char>(allocator, str.size() + 1, flags, site);
 	memcpy(other.data(), str.data(), str.size());
 	other[str.size()] = 0;
 	return other.data();
 }
 
-template<typename T> inline T* alloc(Alloc allocator, u64 flags = 0) {
-	return &alloc_array<T>(allocator, 1, flags)[0];
+template<typename T> inline T* alloc(Alloc allocator, u64 flags = 0, alloc_site site = alloc_site::current()) {
+	return &alloc_array<T>(allocator, 1, flags, site)[0];
 }
 
 template<typename T> inline void dealloc(Alloc allocator, T& t, u64 flags = 0) {
@@ -68,6 +70,8 @@ template<typename T> inline T* duplicate(Alloc allocator, T& t, u64 flags = 0) {
 extern Alloc std_allocator;
 
 u64 round_up_bit(u64 value);
+//* non cryptographic, 4 independent lanes of 8 bytes so the main loop isn't one long dependency chain
+u64 hash_bytes(ROBuffer bytes, u64 seed = 0);
 
 #ifdef BLBLSTD_IMPL
 
@@ -89,6 +93,28 @@ u64 round_up_bit(u64 value) {
 	return value;
 }
 
+u64 hash_bytes(ROBuffer bytes, u64 seed) {
+	constexpr u64 P1 = 0x9e3779b185ebca87ull;
+	constexpr u64 P2 = 0xc2b2ae3d27d4eb4full;
+	constexpr u64 P3 = 0x165667b19e3779f9ull;
+	auto read = [&](usize offset) { u64 word; memcpy(&word, bytes.data() + offset, sizeof(word)); return word; };
+
+	usize i = 0;
+	u64 hash = seed + P3;
+	if (bytes.size() >= 32) {
+		u64 lanes[4] = { seed + P1 + P2, seed + P2, seed, seed - P1 };
+		for (; i + 32 <= bytes.size(); i += 32) for (auto l : u64xrange{ 0, 4 })
+			lanes[l] = rotl(lanes[l] + read(i + l * 8) * P2, 31) * P1;
+		hash = rotl(lanes[0], 1) + rotl(lanes[1], 7) + rotl(lanes[2], 12) + rotl(lanes[3], 18);
+	}
+	hash += bytes.size();
+	for (; i + 8 <= bytes.size(); i += 8)
+		hash = rotl(hash ^ (rotl(read(i) * P2, 31) * P1), 27) * P1 + P3;
+	for (; i < bytes.size(); i++)
+		hash = rotl(hash ^ (bytes[i] * P3), 11) * P1;
+	return hash_mix(hash);
+}
+
 #endif
 
 #endif
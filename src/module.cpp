@@ -2,28 +2,34 @@
 # define G_MODULE
 
 #include <utils.cpp>
+#include <arena.cpp>
 #include <cstdio>
+#include <atomic>
+#include <thread>
 
 #ifdef PLATFORM_WINDOWS
 // #include <windows.h>
 #include <libloaderapi.h>
 #include <errhandlingapi.h>
+#include <fileapi.h>
+#include <winbase.h>
+#include <processthreadsapi.h>
 using Module = HINSTANCE;
 
-Module load_module(string path) {
+inline Module load_module(string path) {
 	auto mod = LoadLibraryA((LPCSTR)path.data());
 	if (mod == null)
 		return fail_ret(GetLastError(), null);
 	return mod;
 }
 
-void unload_module(Module& mod) {
+inline void unload_module(Module& mod) {
 	if (FreeLibrary(mod) == 0)
 		fail_msg(GetLastError());
 	mod = null;
 }
 
-any* get_symbol(Module mod, string name) {
+inline any* get_symbol(Module mod, string name) {
 	auto sym = GetProcAddress(mod, name.data());
 	if (sym == null)
 		return fail_ret(GetLastError(), null);
@@ -32,22 +38,29 @@ any* get_symbol(Module mod, string name) {
 
 #else
 #include <dlfcn.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#if defined(PLATFORM_LINUX) || defined(PLATFORM_ANDROID)
+#include <sys/inotify.h>
+#endif
 using Module = any*;
 
-Module load_module(string path) {
+inline Module load_module(string path) {
 	auto mod = dlopen(path.data(), RTLD_NOW);
 	if (mod == null)
 		return fail_ret(dlerror(), null);
 	return mod;
 }
 
-void unload_module(Module& mod) {
+inline void unload_module(Module& mod) {
 	if (dlclose(mod) != 0)
 		fail_msg(dlerror());
 	mod = null;
 }
 
-any* get_symbol(Module mod, string name) {
+inline any* get_symbol(Module mod, string name) {
 	auto sym = dlsym(mod, name.data());
 	auto err = dlerror();
 	if (err != null)
@@ -61,4 +74,213 @@ template<typename T> auto get_symbol(Module mod, string symbol) {
 	return (T*)get_symbol(mod, symbol);
 }
 
+//* hot reload : the module exports extern "C" hot_module_load & hot_module_unload
+//* load gets the host owned state (long lived arenas...) & returns the module's api table, so nothing is rebuilt on reload
+//* every version is loaded from its own copy so the build can overwrite the original & dlopen doesn't hand back the cached one
+//* calls go through hot_module_enter, the previous version is unloaded once the calls that started on it are done
+
+constexpr auto HOT_MODULE_LOAD = "hot_module_load";
+constexpr auto HOT_MODULE_UNLOAD = "hot_module_unload";
+using HotModuleLoad = const any*(any* state);
+using HotModuleUnload = void(any* state);
+
+struct HotModuleVersion {
+	static constexpr u64 MAX_PATH_SIZE = 1024;
+	Module mod = null;
+	const any* api = null;
+	HotModuleUnload* unload = null;
+	std::atomic<u64> calls = 0;
+	char path[MAX_PATH_SIZE] = {};
+};
+
+struct HotModule {
+	string path;
+	string name;//* file name, what the directory watch reports
+	any* state = null;
+	HotModuleVersion versions[2];
+	std::atomic<HotModuleVersion*> current = null;
+	HotModuleVersion* retiring = null;
+	u64 generation = 0;
+	u64 stamp = 0;
+	bool pending = false;
+	int watch = -1;
+};
+
+//* keeps the version it started on alive until it goes out of scope
+template<typename Api> struct HotCall {
+	HotModuleVersion* version;
+
+	HotCall(HotModuleVersion* v) : version(v) {}
+	HotCall(const HotCall&) = delete;
+	~HotCall() { version->calls.fetch_sub(1, std::memory_order_release); }
+
+	const Api* operator->() const { return (const Api*)version->api; }
+	const Api& operator*() const { return *(const Api*)version->api; }
+};
+
+inline u64 process_id() {
+#ifdef PLATFORM_WINDOWS
+	return GetCurrentProcessId();
+#else
+	return getpid();
+#endif
+}
+
+inline u64 file_stamp(string path) {
+#ifdef PLATFORM_WINDOWS
+	WIN32_FILE_ATTRIBUTE_DATA data;
+	if (!GetFileAttributesExA((LPCSTR)path.data(), GetFileExInfoStandard, &data))
+		return 0;
+	return (u64(data.ftLastWriteTime.dwHighDateTime) << 32) | data.ftLastWriteTime.dwLowDateTime;
+#else
+	struct stat st;
+	if (stat(path.data(), &st) != 0)
+		return 0;
+	return hash_mix(u64(st.st_mtime)) ^ u64(st.st_size);//* seconds only, the size catches most same second rebuilds
+#endif
+}
+
+inline bool copy_file(string from, string to) {
+#ifdef PLATFORM_WINDOWS
+	if (!CopyFileA((LPCSTR)from.data(), (LPCSTR)to.data(), FALSE))
+		return fail_ret(GetLastError(), false);
+	return true;
+#else
+	auto source = map_file(from, FileMap::SEQUENTIAL);
+	if (source.size() == 0)
+		return false;
+	auto out = fopen(to.data(), "wb");
+	auto written = out ? fwrite(source.data(), 1, source.size(), out) : 0;
+	if (out) fclose(out);
+	unmap_file(source);
+	if (written != source.size())
+		return fail_ret(strerror(errno), false);
+	return true;
+#endif
+}
+
+inline bool hot_module_load_version(HotModule& hot, HotModuleVersion& version) {
+	snprintf(version.path, sizeof(version.path), "%.*s.%llu.%llu", int(hot.path.size()), hot.path.data(), process_id(), ++hot.generation);
+	if (!copy_file(hot.path, version.path))
+		return false;
+	version.mod = load_module(version.path);
+	if (version.mod == null)
+		return (remove(version.path), false);
+	auto load = get_symbol<HotModuleLoad>(version.mod, HOT_MODULE_LOAD);
+	version.unload = get_symbol<HotModuleUnload>(version.mod, HOT_MODULE_UNLOAD);
+	version.api = (load && version.unload) ? load(hot.state) : null;
+	if (version.api == null) {
+		unload_module(version.mod);
+		remove(version.path);
+		return fail_ret("module has no api", false);
+	}
+	return true;
+}
+
+inline void hot_module_unload_version(HotModule& hot, HotModuleVersion& version) {
+	version.unload(hot.state);
+	unload_module(version.mod);
+	remove(version.path);
+	version.api = null;
+	version.unload = null;
+}
+
+inline bool hot_module_changed(HotModule& hot) {
+	auto changed = false;
+#if defined(PLATFORM_LINUX) || defined(PLATFORM_ANDROID)
+	if (hot.watch >= 0) {
+		alignas(inotify_event) char events[4096];
+		for (i64 size; (size = read(hot.watch, events, sizeof(events))) > 0;) for (i64 offset = 0; offset < size;) {
+			auto event = (const inotify_event*)(events + offset);
+			changed |= event->len > 0 && hot.name == event->name;
+			offset += sizeof(inotify_event) + event->len;
+		}
+		return changed;
+	}
+#endif
+	auto stamp = file_stamp(hot.path);
+	changed = stamp != 0 && stamp != hot.stamp;
+	hot.stamp = stamp;
+	return changed;
+}
+
+//* null when the first version can't be loaded
+inline HotModule* hot_module_open(Arena& arena, string path, any* state) {
+	auto& hot = *new (&arena.push<HotModule>()) HotModule{};
+	hot.path = arena.push_string(path);
+	auto slash = hot.path.find_last_of("/\\");
+	hot.name = slash == string::npos ? hot.path : hot.path.substr(slash + 1);
+	hot.state = state;
+	hot.stamp = file_stamp(hot.path);
+#if defined(PLATFORM_LINUX) || defined(PLATFORM_ANDROID)
+	hot.watch = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	auto dir = slash == string::npos ? string(".") : arena.push_string(hot.path.substr(0, max(slash, u64(1))));
+	if (hot.watch >= 0 && inotify_add_watch(hot.watch, dir.data(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+		close(hot.watch);//* falls back to polling the write time
+		hot.watch = -1;
+	}
+#endif
+	if (!hot_module_load_version(hot, hot.versions[0])) {
+#if defined(PLATFORM_LINUX) || defined(PLATFORM_ANDROID)
+		if (hot.watch >= 0)
+			close(hot.watch);
+#endif
+		return null;
+	}
+	hot.current = &hot.versions[0];
+	return &hot;
+}
+
+//* call regularly from one thread, unloads the drained version & loads the new one when the file changed
+//* returns true when a new version went live, a failed load is tried again on the next poll
+inline bool hot_module_poll(HotModule& hot) {
+	if (hot.retiring && hot.retiring->calls.load() == 0) {
+		hot_module_unload_version(hot, *hot.retiring);
+		hot.retiring = null;
+	}
+	hot.pending |= hot_module_changed(hot);
+	if (!hot.pending || hot.retiring)//* one version draining at a time
+		return false;
+	auto previous = hot.current.load();
+	auto& next = hot.versions[previous == &hot.versions[0]];
+	if (!hot_module_load_version(hot, next))
+		return false;
+	hot.pending = false;
+	hot.current.store(&next);
+	hot.retiring = previous;
+	if (previous->calls.load() == 0) {
+		hot_module_unload_version(hot, *previous);
+		hot.retiring = null;
+	}
+	return true;
+}
+
+//* counts the call on the live version, the re-check catches a swap that happened before the count was visible
+inline HotModuleVersion* hot_module_acquire(HotModule& hot) {
+	while (true) {
+		auto version = hot.current.load();
+		version->calls.fetch_add(1);
+		if (hot.current.load() == version)
+			return version;
+		version->calls.fetch_sub(1);
+	}
+}
+
+template<typename Api> HotCall<Api> hot_module_enter(HotModule& hot) { return HotCall<Api>(hot_module_acquire(hot)); }
+
+inline void hot_module_close(HotModule& hot) {
+	for (auto& version : hot.versions) if (version.api) {
+		while (version.calls.load() > 0)
+			std::this_thread::yield();
+		hot_module_unload_version(hot, version);
+	}
+	hot.current = null;
+	hot.retiring = null;
+#if defined(PLATFORM_LINUX) || defined(PLATFORM_ANDROID)
+	if (hot.watch >= 0)
+		close(hot.watch);
+	hot.watch = -1;
+#endif
+}
+
 #endif
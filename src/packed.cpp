@@ -0,0 +1,271 @@
+#ifndef G_PACKED
+# define G_PACKED
+
+#include <utils.cpp>
+#include <arena.cpp>
+#include <high_order.cpp>
+#include <string.h>
+#include <utility>
+
+//* compressed integer arrays living in an arena, values go in as u32 or u64 & come out as any integer type wide enough for them
+//* PackedArray : frame of reference, each value stored as value - base on the bits of max - base, O(1) random access
+//* DeltaArray : non decreasing values as LEB128 varint gaps, every DELTA_BLOCK values restart from a first value kept in a block index
+//* both decode a block at a time, fold & filter run on those blocks without decoding the whole array
+
+constexpr u64 PACK_BLOCK = 64;//* 64 values of width bits are exactly width words, so every block starts on a word
+constexpr u64 DELTA_BLOCK = 128;
+
+inline constexpr u64 low_bits(u32 width) { return width >= 64 ? ~u64(0) : (u64(1) << width) - 1; }
+inline u32 bit_width_of(u64 value) { return value ? 64 - __builtin_clzll(value) : 0; }
+
+//* shifts & masks are constants for a given width & position, so a block unpack unrolls to straight line code the compiler can vectorize
+template<u32 W, u64 K> inline u64 unpack_one(const u64* in) {
+	if constexpr (W == 0) {
+		return 0;
+	} else {
+		constexpr u64 word = K * W / 64;
+		constexpr u64 offset = K * W % 64;
+		if constexpr (offset + W <= 64)
+			return (in[word] >> offset) & low_bits(W);
+		else
+			return ((in[word] >> offset) | (in[word + 1] << (64 - offset))) & low_bits(W);
+	}
+}
+
+template<typename T> using unpack_fn = void(*)(const u64*, u64, T*);
+
+template<u32 W, typename T> void unpack_block(const u64* in, u64 base, T* out) {
+	[&]<u64... K>(std::index_sequence<K...>) {
+		((out[K] = T(base + unpack_one<W, K>(in))), ...);
+	}(std::make_index_sequence<PACK_BLOCK>{});
+}
+
+template<typename T> struct Unpackers {
+	unpack_fn<T> by_width[65];
+};
+
+template<typename T> constexpr Unpackers<T> unpackers = []<u32... W>(std::integer_sequence<u32, W...>) {
+	return Unpackers<T>{ { &unpack_block<W, T>... } };
+}(std::make_integer_sequence<u32, 65>{});
+
+struct PackedArray {
+	Array<u64> words;//* one spare word at the end so random access can always read two
+	u64 count = 0;
+	u64 base = 0;
+	u32 width = 0;
+
+	inline u64 size() const { return count; }
+	inline u64 size_bytes() const { return words.size_bytes(); }
+	inline u64 block_count() const { return (count + PACK_BLOCK - 1) / PACK_BLOCK; }
+
+	inline u64 operator[](u64 index) const {
+		assert(index < count);
+		if (width == 0)
+			return base;
+		auto position = index * width;
+		auto word = position / 64;
+		auto offset = position % 64;
+		auto bits = (words[word] >> offset) | ((words[word + 1] << 1) << (63 - offset));//* 2 shifts so offset 0 doesn't shift by 64
+		return base + (bits & low_bits(width));
+	}
+
+	//* always writes PACK_BLOCK values, the ones past count are garbage, returns how many are real
+	template<typename T> u64 decode_block(u64 block, T* out) const {
+		unpackers<T>.by_width[width](words.data() + block * width, base, out);
+		return min(PACK_BLOCK, count - block * PACK_BLOCK);
+	}
+
+	//* out must hold count values
+	template<typename T> Array<T> decode_into(Array<T> out) const {
+		assert(out.size() >= count);
+		u64 full = count / PACK_BLOCK;
+		for (auto block : u64xrange{ 0, full })
+			decode_block(block, out.data() + block * PACK_BLOCK);
+		if (full * PACK_BLOCK < count) {
+			T tail[PACK_BLOCK];
+			auto n = decode_block(full, tail);
+			memcpy(out.data() + full * PACK_BLOCK, tail, n * sizeof(T));
+		}
+		return out.subspan(0, count);
+	}
+
+	template<typename T = u32> Array<T> decode(Arena& arena) const { return decode_into(arena.push_array<T>(count)); }
+
+	//* f(Array<const u64> values, u64 first_index) for each decoded block
+	template<typename F> void for_each_block(F f) const {
+		u64 values[PACK_BLOCK];
+		for (auto block : u64xrange{ 0, block_count() }) {
+			auto n = decode_block(block, values);
+			f(Array<const u64>(values, n), block * PACK_BLOCK);
+		}
+	}
+
+	template<typename R> R fold(const R& init, auto acc) const {
+		R result = init;
+		for_each_block([&](Array<const u64> values, u64) {
+			for (auto v : values)
+				result = acc(result, v);
+		});
+		return result;
+	}
+
+	Array<u64> filter(Arena& arena, auto predicate) const {
+		auto kept = List{ arena.push_array<u64>(count), 0 };
+		for_each_block([&](Array<const u64> values, u64) {
+			for (auto v : values) if (predicate(v))
+				kept.push(v);
+		});
+		return kept.shrink_to_content(arena);
+	}
+};
+
+template<typename T> PackedArray packed_array_make(Arena& arena, Array<const T> values) {
+	static_assert(std::is_unsigned_v<T>);
+	PackedArray packed = {};
+	packed.count = values.size();
+	if (values.size() == 0)
+		return packed;
+	T low = values[0], high = values[0];
+	for (auto v : values) {
+		low = min(low, v);
+		high = max(high, v);
+	}
+	packed.base = low;
+	packed.width = bit_width_of(u64(high) - low);
+	packed.words = arena.push_array<u64>(packed.block_count() * packed.width + 1, true);
+	for (auto i : u64xrange{ 0, values.size() }) {
+		auto value = u64(values[i]) - low;
+		auto position = i * packed.width;
+		auto word = position / 64;
+		auto offset = position % 64;
+		if (packed.width == 0)
+			continue;
+		packed.words[word] |= value << offset;
+		if (offset + packed.width > 64)
+			packed.words[word + 1] |= value >> (64 - offset);
+	}
+	return packed;
+}
+
+template<typename T> PackedArray packed_array_make(Arena& arena, Array<T> values) { return packed_array_make(arena, Array<const T>(values)); }
+
+struct DeltaBlock {
+	u64 first;
+	u64 offset;//* of the block's gaps in bytes
+};
+
+inline u8* varint_write(u8* out, u64 value) {
+	while (value >= 0x80) {
+		*out++ = u8(value) | 0x80;
+		value >>= 7;
+	}
+	*out++ = u8(value);
+	return out;
+}
+
+inline const u8* varint_read(const u8* in, u64& value) {
+	u64 byte = *in++;
+	value = byte & 0x7f;
+	for (u32 shift = 7; byte & 0x80; shift += 7) {
+		byte = *in++;
+		value |= (byte & 0x7f) << shift;
+	}
+	return in;
+}
+
+struct DeltaArray {
+	Array<DeltaBlock> blocks;
+	Array<u8> bytes;
+	u64 count = 0;
+
+	inline u64 size() const { return count; }
+	inline u64 size_bytes() const { return blocks.size_bytes() + bytes.size_bytes(); }
+	inline u64 block_count() const { return blocks.size(); }
+
+	//* reads the gaps of the block up to index, O(DELTA_BLOCK)
+	u64 operator[](u64 index) const {
+		assert(index < count);
+		auto& block = blocks[index / DELTA_BLOCK];
+		auto value = block.first;
+		const u8* in = bytes.data() + block.offset;
+		for (u64 gap, i = 0; i < index % DELTA_BLOCK; i++) {
+			in = varint_read(in, gap);
+			value += gap;
+		}
+		return value;
+	}
+
+	//* gaps are read in place, then turned into values by the vector prefix sum, returns the count written (at most DELTA_BLOCK)
+	template<typename T> u64 decode_block(u64 block, T* out) const {
+		auto n = min(DELTA_BLOCK, count - block * DELTA_BLOCK);
+		const u8* in = bytes.data() + blocks[block].offset;
+		out[0] = blocks[block].first;
+		for (auto i : u64xrange{ 1, n }) {
+			u64 gap;
+			in = varint_read(in, gap);
+			out[i] = T(gap);
+		}
+		scan_inclusive_into(out + 1, out + 1, n - 1, out[0], std::plus<>{});
+		return n;
+	}
+
+	template<typename T> Array<T> decode_into(Array<T> out) const {
+		assert(out.size() >= count);
+		for (auto block : u64xrange{ 0, block_count() })
+			decode_block(block, out.data() + block * DELTA_BLOCK);
+		return out.subspan(0, count);
+	}
+
+	template<typename T = u32> Array<T> decode(Arena& arena) const { return decode_into(arena.push_array<T>(count)); }
+
+	template<typename F> void for_each_block(F f) const {
+		u64 values[DELTA_BLOCK];
+		for (auto block : u64xrange{ 0, block_count() }) {
+			auto n = decode_block(block, values);
+			f(Array<const u64>(values, n), block * DELTA_BLOCK);
+		}
+	}
+
+	template<typename R> R fold(const R& init, auto acc) const {
+		R result = init;
+		for_each_block([&](Array<const u64> values, u64) {
+			for (auto v : values)
+				result = acc(result, v);
+		});
+		return result;
+	}
+
+	Array<u64> filter(Arena& arena, auto predicate) const {
+		auto kept = List{ arena.push_array<u64>(count), 0 };
+		for_each_block([&](Array<const u64> values, u64) {
+			for (auto v : values) if (predicate(v))
+				kept.push(v);
+		});
+		return kept.shrink_to_content(arena);
+	}
+};
+
+//* values must be non decreasing
+template<typename T> DeltaArray delta_array_make(Arena& arena, Array<const T> values) {
+	static_assert(std::is_unsigned_v<T>);
+	constexpr u64 MAX_VARINT = (sizeof(T) * 8 + 6) / 7;
+	DeltaArray delta = {};
+	delta.count = values.size();
+	delta.blocks = arena.push_array<DeltaBlock>((values.size() + DELTA_BLOCK - 1) / DELTA_BLOCK);
+	delta.bytes = arena.push_array<u8>(values.size() * MAX_VARINT);
+	auto out = delta.bytes.data();
+	for (auto i : u64xrange{ 0, values.size() }) {
+		if (i % DELTA_BLOCK == 0) {
+			delta.blocks[i / DELTA_BLOCK] = { values[i], u64(out - delta.bytes.data()) };
+			continue;
+		}
+		assert(values[i - 1] <= values[i]);
+		out = varint_write(out, values[i] - values[i - 1]);
+	}
+	delta.bytes = arena.morph_array(delta.bytes, out - delta.bytes.data());//* still the arena tip, gives the unused bytes back
+	return delta;
+}
+
+template<typename T> DeltaArray delta_array_make(Arena& arena, Array<T> values) { return delta_array_make(arena, Array<const T>(values)); }
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef G_PARALLEL
+# define G_PARALLEL
+
+#include <utils.cpp>
+#include <scratch.cpp>
+#include <thread>
+
+u32 hardware_threads();
+
+//* runs task(index, count) on count threads, the calling thread takes index 0, returns once every task is done
+//* tasks can use scratch_push_scope, the worker threads are made for the call & release their thread_local scratches before exiting
+template<typename F> void parallel_for(u32 count, F task) {
+	constexpr u32 MAX_THREADS = 256;
+	count = min(max(count, 1u), MAX_THREADS);
+	std::thread workers[MAX_THREADS - 1];
+	for (auto i : u32xrange{ 1, count })
+		workers[i - 1] = std::thread([&task, i, count]() {
+			task(i, count);
+			scratch_clear();
+		});
+	task(0u, count);
+	for (auto i : u32xrange{ 1, count })
+		workers[i - 1].join();
+}
+
+#ifdef BLBLSTD_IMPL
+
+u32 hardware_threads() { return max(std::thread::hardware_concurrency(), 1u); }
+
+#endif
+
+#endif
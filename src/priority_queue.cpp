@@ -0,0 +1,138 @@
+#ifndef G_PRIORITY_QUEUE
+# define G_PRIORITY_QUEUE
+
+#include <utils.cpp>
+#include <list.cpp>
+#include <arena.cpp>
+#include <sorted.cpp>
+
+//* d-ary min heap (top is the lowest by less), wide nodes keep the tree shallow & the children of a node on one cache line
+//* every element gets a handle that follows it around the heap, for decrease_key & remove
+//* handles are recycled once their element left the queue
+template<typename T, u32 D = 4, typename Less = decltype(default_less)> struct PriorityQueue {
+	static_assert(D >= 2);
+	static constexpr u32 NONE = ~0u;
+
+	struct Entry {
+		T value;
+		u32 handle;
+	};
+
+	List<Entry> heap;
+	List<u32> positions;//* heap index of each handle, next free handle while unused
+	u32 free_handle = NONE;
+	Less less = {};
+
+	inline u64 size() const { return heap.current; }
+	inline bool empty() const { return heap.current == 0; }
+	inline const T& top() const { return heap[0].value; }
+	inline const T& operator[](u32 handle) const { return heap[positions[handle]].value; }
+
+	inline void place(u64 index, Entry&& entry) {
+		positions[entry.handle] = index;
+		heap[index] = std::move(entry);
+	}
+
+	void sift_up(u64 index) {
+		auto entry = std::move(heap[index]);
+		while (index > 0) {
+			auto parent = (index - 1) / D;
+			if (!less(entry.value, heap[parent].value))
+				break;
+			place(index, std::move(heap[parent]));
+			index = parent;
+		}
+		place(index, std::move(entry));
+	}
+
+	void sift_down(u64 index) {
+		auto entry = std::move(heap[index]);
+		while (true) {
+			auto first = index * D + 1;
+			if (first >= heap.current)
+				break;
+			auto best = first;
+			for (auto child : u64xrange{ first + 1, min(first + D, u64(heap.current)) }) if (less(heap[child].value, heap[best].value))
+				best = child;
+			if (!less(heap[best].value, entry.value))
+				break;
+			place(index, std::move(heap[best]));
+			index = best;
+		}
+		place(index, std::move(entry));
+	}
+
+	u32 new_handle(Arena& arena) {
+		if (free_handle != NONE) {
+			auto handle = free_handle;
+			free_handle = positions[handle];
+			return handle;
+		}
+		positions.push_growing(arena, 0u);
+		return positions.current - 1;
+	}
+
+	u32 push(Arena& arena, const T& value) {
+		auto handle = new_handle(arena);
+		heap.push_growing(arena, Entry{ value, handle });
+		sift_up(heap.current - 1);
+		return handle;
+	}
+
+	//* removes the element at index, the last one takes its place & goes whichever way it has to
+	T remove_at(u64 index) {
+		auto entry = std::move(heap[index]);
+		auto last = heap.pop();
+		if (index < heap.current) {
+			place(index, std::move(last));
+			if (index > 0 && less(heap[index].value, heap[(index - 1) / D].value))
+				sift_up(index);
+			else
+				sift_down(index);
+		}
+		positions[entry.handle] = free_handle;
+		free_handle = entry.handle;
+		return std::move(entry.value);
+	}
+
+	inline T pop() {
+		assert(!empty());
+		return remove_at(0);
+	}
+
+	inline T remove(u32 handle) { return remove_at(positions[handle]); }
+
+	//* value must not be greater than the current one
+	void decrease_key(u32 handle, const T& value) {
+		auto index = positions[handle];
+		assert(!less(heap[index].value, value));
+		heap[index].value = value;
+		sift_up(index);
+	}
+
+	void update(u32 handle, const T& value) {
+		auto index = positions[handle];
+		auto lower = less(value, heap[index].value);
+		heap[index].value = value;
+		if (lower)
+			sift_up(index);
+		else
+			sift_down(index);
+	}
+
+	//* bulk insert in O(n), handles of the queue's elements stay valid, the new ones are returned in input order
+	Array<u32> heapify(Arena& arena, Array<const T> values) {
+		auto handles = arena.push_array<u32>(values.size());
+		auto dest = heap.push_growing(arena, values.size());
+		for (auto i : u64xrange{ 0, values.size() }) {
+			handles[i] = new_handle(arena);
+			dest[i] = Entry{ values[i], handles[i] };
+			positions[handles[i]] = dest.data() - heap.capacity.data() + i;
+		}
+		if (heap.current > 1) for (auto i = (heap.current - 2) / D + 1; i-- > 0;)
+			sift_down(i);
+		return handles;
+	}
+};
+
+#endif
@@ -0,0 +1,146 @@
+#ifndef G_PROFILER
+# define G_PROFILER
+
+#include <utils.cpp>
+
+//* opt-in allocation profiler, define BLBLSTD_ALLOC_PROFILE for every translation unit to turn it on
+//* arena pushes & morphs, List growth and Alloc::alloc take a defaulted alloc_site so the callsite is the caller's
+//* without the define alloc_site is an empty struct and every hook compiles to nothing
+
+struct AllocProfile {
+	enum : u64 {
+		BYTES,
+		COUNT,
+		GROWTHS,//* allocations that made an arena chain a sub arena or replace its vmem
+	};
+};
+
+#ifdef BLBLSTD_ALLOC_PROFILE
+#include <atomic>
+#include <source_location>
+
+using alloc_site = std::source_location;
+
+struct AllocSiteStats {
+	std::atomic<const char*> file;//* published last, null while the slot is free
+	const char* function;
+	u32 line;
+	u32 column;
+	std::atomic<u64> bytes;
+	std::atomic<u64> count;
+	std::atomic<u64> growths;
+};
+
+//* one per thread, only its thread writes so counters are plain relaxed load/store, the dump reads them from anywhere
+struct AllocProfileTable {
+	static constexpr u64 CAPACITY = 4096;
+	AllocProfileTable* next;
+	std::atomic<u64> dropped;//* allocations from sites that didn't fit in the table
+	AllocSiteStats sites[CAPACITY];
+};
+
+void profile_alloc(const alloc_site& site, u64 bytes);
+void profile_growth(const alloc_site& site);
+
+#else
+
+struct alloc_site { static consteval alloc_site current() { return {}; } };
+
+inline void profile_alloc(const alloc_site&, u64) {}
+inline void profile_growth(const alloc_site&) {}
+
+#endif
+
+//* collapsed stack lines (function;file:line value) over every thread, readable by flamegraph.pl or pprof
+//* returns false when the profiler is off or the file can't be opened
+bool alloc_profile_dump(string path, u64 metric = AllocProfile::BYTES);
+
+#ifdef BLBLSTD_IMPL
+#include <stdio.h>
+
+#ifdef BLBLSTD_ALLOC_PROFILE
+#include <stdlib.h>
+#include <new>
+
+static std::atomic<AllocProfileTable*> alloc_profile_tables = null;
+
+//* never freed, so the counts of finished threads still get dumped
+static AllocProfileTable& local_alloc_profile() {
+	static thread_local AllocProfileTable* local = []() {
+		auto table = new (calloc(1, sizeof(AllocProfileTable))) AllocProfileTable{};
+		table->next = alloc_profile_tables.load(std::memory_order_relaxed);
+		while (!alloc_profile_tables.compare_exchange_weak(table->next, table, std::memory_order_release, std::memory_order_relaxed));
+		return table;
+	}();
+	return *local;
+}
+
+static inline void bump(std::atomic<u64>& counter, u64 value) { counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed); }
+
+static AllocSiteStats* find_site(const alloc_site& site) {
+	auto& table = local_alloc_profile();
+	auto hash = hash_mix(u64(site.file_name()) ^ (u64(site.line()) << 32) ^ site.column());
+	for (auto probe : u64xrange{ 0, AllocProfileTable::CAPACITY }) {
+		auto& stats = table.sites[(hash + probe) % AllocProfileTable::CAPACITY];
+		auto file = stats.file.load(std::memory_order_relaxed);
+		if (file == null) {
+			stats.function = site.function_name();
+			stats.line = site.line();
+			stats.column = site.column();
+			stats.file.store(site.file_name(), std::memory_order_release);
+			return &stats;
+		}
+		if (file == site.file_name() && stats.line == site.line() && stats.column == site.column())
+			return &stats;
+	}
+	bump(table.dropped, 1);
+	return null;
+}
+
+void profile_alloc(const alloc_site& site, u64 bytes) {
+	if (auto stats = find_site(site)) {
+		bump(stats->bytes, bytes);
+		bump(stats->count, 1);
+	}
+}
+
+void profile_growth(const alloc_site& site) {
+	if (auto stats = find_site(site))
+		bump(stats->growths, 1);
+}
+
+bool alloc_profile_dump(string path, u64 metric) {
+	auto out = fopen(path.data(), "w");
+	if (!out)
+		return false;
+	u64 dropped = 0;
+	for (auto table = alloc_profile_tables.load(std::memory_order_acquire); table; table = table->next) {
+		dropped += table->dropped.load(std::memory_order_relaxed);
+		for (auto& stats : table->sites) {
+			auto file = stats.file.load(std::memory_order_acquire);
+			if (file == null)
+				continue;
+			auto& counter = metric == AllocProfile::BYTES ? stats.bytes : metric == AllocProfile::COUNT ? stats.count : stats.growths;
+			auto value = counter.load(std::memory_order_relaxed);
+			if (value == 0)
+				continue;
+			for (auto c = stats.function; *c; c++)//* ; separates frames
+				fputc(*c == ';' ? ',' : *c, out);
+			fprintf(out, ";%s:%u %llu\n", file, stats.line, value);
+		}
+	}
+	fclose(out);
+	if (dropped > 0)
+		fprintf(stderr, "Warning allocation profile dropped %llu allocations, site table full\n", dropped);
+	return true;
+}
+
+#else
+
+bool alloc_profile_dump(string, u64) { return false; }
+
+#endif
+
+#endif
+
+#endif
@@ -4,12 +4,15 @@
 #include <arena.cpp>
 
 #include <list.cpp>
-Array<Arena> scratch_preallocate(u64 size, u64 channels = 1);
+//* prefault_size bytes of each scratch are faulted in right away, for threads that must not fault on their first requests
+Array<Arena> scratch_preallocate(u64 size, u64 channels = 1, u64 prefault_size = 0);
 void scratch_clear(bool root = true);
 tuple<Arena&, u64> scratch_push_scope(u64 size = 0, Array<const Arena* const> collisions = {});
 tuple<Arena&, u64> scratch_push_scope(u64 size, LiteralArray<const Arena*> collision);
 tuple<Arena&, u64> scratch_push_scope(u64 size, const Arena* const collision);
 Arena& scratch_pop_scope(Arena& arena, u64 scope);
+//* decommits what the calling thread's scratches have committed past their scopes, for memory pressure callbacks
+u64 scratch_trim();
 
 // #define BLBLSTD_IMPL
 #ifdef BLBLSTD_IMPL
@@ -25,13 +28,14 @@ static List<Arena> &get_scratches() {
 	return scratches;
 }
 
-constexpr auto SCRATCH_FLAGS = Arena::COMMIT_ON_PUSH | Arena::DECOMMIT_ON_EMPTY | Arena::ALLOW_CHAIN_GROWTH | Arena::ALLOW_MOVE_MORPH;
+//* scratches are thread local, their pages stay on the node of their thread
+constexpr auto SCRATCH_FLAGS = Arena::COMMIT_ON_PUSH | Arena::DECOMMIT_ON_EMPTY | Arena::ALLOW_CHAIN_GROWTH | Arena::ALLOW_MOVE_MORPH | Arena::NUMA_LOCAL;
 
-Array<Arena> scratch_preallocate(u64 size, u64 channels) {
+Array<Arena> scratch_preallocate(u64 size, u64 channels, u64 prefault_size) {
 	auto& scratches = get_scratches();
 	auto begin = scratches.current;
 	for (auto i = 0u; i < channels; i++)
-		scratches.push(Arena::from_vmem(size, SCRATCH_FLAGS));
+		scratches.push(Arena::from_vmem(size, SCRATCH_FLAGS, null, prefault_size));
 	return scratches.used().subspan(begin, channels);
 }
 
@@ -72,6 +76,13 @@ tuple<Arena&, u64> scratch_push_scope(u64 size, LiteralArray<const Arena*> colli
 tuple<Arena&, u64> scratch_push_scope(u64 size, const Arena* const collision) { return scratch_push_scope(size, carray(&collision, 1)); }
 Arena& scratch_pop_scope(Arena& arena, u64 scope) { return (arena.pop_to(scope), arena); }
 
+u64 scratch_trim() {
+	u64 released = 0;
+	for (auto& s : get_scratches().used())
+		released += s.trim();
+	return released;
+}
+
 #endif
 
 #endif
@@ -0,0 +1,114 @@
+#ifndef G_SIMD
+# define G_SIMD
+
+#include <utils.cpp>
+
+//* minimal byte vector layer, picked at compile time : AVX2, SSE2 or a plain array the compiler can do what it wants with
+//* masks have one bit per byte lane, lowest bit is the lowest address
+//* simd_lookup16 indexes a 16 byte table with the low nibble of every lane, SIMD_HAS_LOOKUP is false when it falls back to a scalar loop
+//* simd_prev<N> shifts N lanes of the previous block into the current one, lane i gets the byte N before it in the stream
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+
+using simd_bytes = __m256i;
+using simd_mask = u32;
+constexpr u64 SIMD_WIDTH = 32;
+
+inline simd_bytes simd_load(const any* ptr) { return _mm256_loadu_si256((const __m256i*)ptr); }
+inline void simd_store(any* ptr, simd_bytes v) { _mm256_storeu_si256((__m256i*)ptr, v); }
+inline simd_bytes simd_splat(u8 value) { return _mm256_set1_epi8(value); }
+inline simd_bytes simd_or(simd_bytes a, simd_bytes b) { return _mm256_or_si256(a, b); }
+inline simd_bytes simd_and(simd_bytes a, simd_bytes b) { return _mm256_and_si256(a, b); }
+inline simd_bytes simd_eq(simd_bytes a, simd_bytes b) { return _mm256_cmpeq_epi8(a, b); }
+inline simd_mask simd_high_bits(simd_bytes v) { return _mm256_movemask_epi8(v); }
+inline simd_bytes simd_xor(simd_bytes a, simd_bytes b) { return _mm256_xor_si256(a, b); }
+inline simd_bytes simd_sub_sat(simd_bytes a, simd_bytes b) { return _mm256_subs_epu8(a, b); }
+inline simd_bytes simd_high_nibbles(simd_bytes v) { return _mm256_and_si256(_mm256_srli_epi16(v, 4), simd_splat(0x0f)); }
+inline bool simd_any(simd_bytes v) { return !_mm256_testz_si256(v, v); }
+
+constexpr bool SIMD_HAS_LOOKUP = true;
+inline simd_bytes simd_table16(const u8* table) { return _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)table)); }
+inline simd_bytes simd_lookup16(simd_bytes table, simd_bytes indices) { return _mm256_shuffle_epi8(table, indices); }
+template<u32 N> inline simd_bytes simd_prev(simd_bytes current, simd_bytes previous) {
+	return _mm256_alignr_epi8(current, _mm256_permute2x128_si256(previous, current, 0x21), 16 - N);//* alignr only shifts within 128 bit halves
+}
+
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+
+using simd_bytes = __m128i;
+using simd_mask = u32;
+constexpr u64 SIMD_WIDTH = 16;
+
+inline simd_bytes simd_load(const any* ptr) { return _mm_loadu_si128((const __m128i*)ptr); }
+inline void simd_store(any* ptr, simd_bytes v) { _mm_storeu_si128((__m128i*)ptr, v); }
+inline simd_bytes simd_splat(u8 value) { return _mm_set1_epi8(value); }
+inline simd_bytes simd_or(simd_bytes a, simd_bytes b) { return _mm_or_si128(a, b); }
+inline simd_bytes simd_and(simd_bytes a, simd_bytes b) { return _mm_and_si128(a, b); }
+inline simd_bytes simd_eq(simd_bytes a, simd_bytes b) { return _mm_cmpeq_epi8(a, b); }
+inline simd_mask simd_high_bits(simd_bytes v) { return _mm_movemask_epi8(v); }
+inline simd_bytes simd_xor(simd_bytes a, simd_bytes b) { return _mm_xor_si128(a, b); }
+inline simd_bytes simd_sub_sat(simd_bytes a, simd_bytes b) { return _mm_subs_epu8(a, b); }
+inline simd_bytes simd_high_nibbles(simd_bytes v) { return _mm_and_si128(_mm_srli_epi16(v, 4), simd_splat(0x0f)); }
+inline bool simd_any(simd_bytes v) { return _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128())) != 0xffff; }
+template<u32 N> inline simd_bytes simd_prev(simd_bytes current, simd_bytes previous) { return _mm_or_si128(_mm_slli_si128(current, N), _mm_srli_si128(previous, 16 - N)); }
+
+inline simd_bytes simd_table16(const u8* table) { return _mm_loadu_si128((const __m128i*)table); }
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+constexpr bool SIMD_HAS_LOOKUP = true;
+inline simd_bytes simd_lookup16(simd_bytes table, simd_bytes indices) { return _mm_shuffle_epi8(table, indices); }
+#else
+constexpr bool SIMD_HAS_LOOKUP = false;//* pshufb is SSSE3
+inline simd_bytes simd_lookup16(simd_bytes table, simd_bytes indices) {
+	alignas(16) u8 t[16], i[16];
+	_mm_store_si128((__m128i*)t, table);
+	_mm_store_si128((__m128i*)i, indices);
+	for (auto& index : i)
+		index = t[index & 0x0f];
+	return _mm_load_si128((const __m128i*)i);
+}
+#endif
+
+#else
+#include <string.h>
+
+struct simd_bytes { u8 lanes[16]; };
+using simd_mask = u32;
+constexpr u64 SIMD_WIDTH = 16;
+
+inline simd_bytes simd_load(const any* ptr) { simd_bytes v; memcpy(&v, ptr, sizeof(v)); return v; }
+inline void simd_store(any* ptr, simd_bytes v) { memcpy(ptr, &v, sizeof(v)); }
+inline simd_bytes simd_splat(u8 value) { simd_bytes v; memset(&v, value, sizeof(v)); return v; }
+inline simd_bytes simd_or(simd_bytes a, simd_bytes b) { for (auto i : u64xrange{ 0, SIMD_WIDTH }) a.lanes[i] |= b.lanes[i]; return a; }
+inline simd_bytes simd_and(simd_bytes a, simd_bytes b) { for (auto i : u64xrange{ 0, SIMD_WIDTH }) a.lanes[i] &= b.lanes[i]; return a; }
+inline simd_bytes simd_eq(simd_bytes a, simd_bytes b) { for (auto i : u64xrange{ 0, SIMD_WIDTH }) a.lanes[i] = a.lanes[i] == b.lanes[i] ? 0xff : 0; return a; }
+inline simd_mask simd_high_bits(simd_bytes v) {
+	simd_mask mask = 0;
+	for (auto i : u64xrange{ 0, SIMD_WIDTH }) mask |= simd_mask(v.lanes[i] >> 7) << i;
+	return mask;
+}
+inline simd_bytes simd_xor(simd_bytes a, simd_bytes b) { for (auto i : u64xrange{ 0, SIMD_WIDTH }) a.lanes[i] ^= b.lanes[i]; return a; }
+inline simd_bytes simd_sub_sat(simd_bytes a, simd_bytes b) { for (auto i : u64xrange{ 0, SIMD_WIDTH }) a.lanes[i] = a.lanes[i] > b.lanes[i] ? a.lanes[i] - b.lanes[i] : 0; return a; }
+inline simd_bytes simd_high_nibbles(simd_bytes v) { for (auto& l : v.lanes) l >>= 4; return v; }
+inline bool simd_any(simd_bytes v) {
+	u8 acc = 0;
+	for (auto l : v.lanes) acc |= l;
+	return acc != 0;
+}
+template<u32 N> inline simd_bytes simd_prev(simd_bytes current, simd_bytes previous) {
+	simd_bytes v;
+	for (auto i : u64xrange{ 0, SIMD_WIDTH }) v.lanes[i] = i >= N ? current.lanes[i - N] : previous.lanes[SIMD_WIDTH + i - N];
+	return v;
+}
+
+constexpr bool SIMD_HAS_LOOKUP = false;
+inline simd_bytes simd_table16(const u8* table) { return simd_load(table); }
+inline simd_bytes simd_lookup16(simd_bytes table, simd_bytes indices) { for (auto& l : indices.lanes) l = table.lanes[l & 0x0f]; return indices; }
+
+#endif
+
+inline simd_mask simd_eq_mask(simd_bytes a, simd_bytes b) { return simd_high_bits(simd_eq(a, b)); }
+
+#endif
@@ -0,0 +1,95 @@
+#ifndef G_SLOT_MAP
+# define G_SLOT_MAP
+
+#include <utils.cpp>
+#include <list.cpp>
+#include <arena.cpp>
+
+//* dense storage with stable handles : values stay packed for iteration, removal swaps the last value into the hole
+//* & the slot indirection keeps every handle pointing to its value, handles of removed values stop resolving
+//* a handle is slot index | generation << INDEX_BITS, the generation is bumped on removal
+//! generations wrap, a handle kept across 2^GENERATION_BITS reuses of the same slot would resolve again
+template<typename T, typename H = u64> struct SlotMap {
+	static_assert(std::is_same_v<H, u32> || std::is_same_v<H, u64>);
+	static constexpr u32 INDEX_BITS = sizeof(H) == 4 ? 20 : 32;
+	static constexpr u32 GENERATION_BITS = sizeof(H) * 8 - INDEX_BITS;
+	static constexpr H INDEX_MASK = (H(1) << INDEX_BITS) - 1;
+	static constexpr u32 GENERATION_MASK = u32((u64(1) << GENERATION_BITS) - 1);
+	static constexpr u32 NONE = ~0u;
+
+	struct Slot {
+		u32 index;//* dense index while alive, next free slot otherwise
+		u32 generation;
+	};
+
+	List<T> dense;
+	List<u32> owners;//* slot of each dense value
+	List<Slot> slots;
+	u32 free_head = NONE;
+
+	static inline H make_handle(u32 slot, u32 generation) { return H(slot) | (H(generation) << INDEX_BITS); }
+	static inline u32 slot_of(H handle) { return handle & INDEX_MASK; }
+	static inline u32 generation_of(H handle) { return u32(handle >> INDEX_BITS) & GENERATION_MASK; }
+
+	inline bool contains(H handle) const {
+		auto s = slot_of(handle);
+		return s < slots.current && slots[s].generation == generation_of(handle) && slots[s].index < dense.current && owners[slots[s].index] == s;
+	}
+
+	H insert(Arena& arena, const T& value) {
+		u32 s = free_head;
+		if (s != NONE) {
+			free_head = slots[s].index;
+		} else {
+			assert(slots.current <= INDEX_MASK);
+			s = slots.current;
+			slots.push_growing(arena, Slot{ 0, 0 });
+		}
+		slots[s].index = dense.current;
+		dense.grow(arena);//* push_growing(arena, value) is ambiguous with the count overload for integer T
+		dense.push(value);
+		owners.push_growing(arena, s);
+		return make_handle(s, slots[s].generation);
+	}
+
+	//* false when the handle was already removed
+	bool remove(H handle) {
+		if (!contains(handle))
+			return false;
+		auto s = slot_of(handle);
+		auto d = slots[s].index;
+		dense.swap_out(d);
+		owners.swap_out(d);
+		if (d < dense.current)
+			slots[owners[d]].index = d;
+		slots[s].generation = (slots[s].generation + 1) & GENERATION_MASK;
+		slots[s].index = free_head;
+		free_head = s;
+		return true;
+	}
+
+	inline T* get(H handle) { return contains(handle) ? &dense[slots[slot_of(handle)].index] : null; }
+	inline const T* get(H handle) const { return contains(handle) ? &dense[slots[slot_of(handle)].index] : null; }
+	inline T& operator[](H handle) {
+		assert(contains(handle));
+		return dense[slots[slot_of(handle)].index];
+	}
+
+	//* handle of the value at a dense index, for iterations that need to hand out handles
+	inline H handle_at(u64 dense_index) const {
+		auto s = owners[dense_index];
+		return make_handle(s, slots[s].generation);
+	}
+
+	void clear() {
+		while (dense.current > 0)
+			remove(handle_at(dense.current - 1));
+	}
+
+	inline u64 size() const { return dense.current; }
+	inline Array<T> values() const { return dense.used(); }
+	inline auto begin() const { return values().begin(); }
+	inline auto end() const { return values().end(); }
+};
+
+#endif
@@ -0,0 +1,241 @@
+#ifndef G_SNAPSHOT
+# define G_SNAPSHOT
+
+#include <arena.cpp>
+#include <scratch.cpp>
+
+//* self relative pointer, stays valid wherever the memory holding both it and its target gets mapped
+//* copying re-targets the offset so moving a rel_ptr around by value keeps pointing at the same object
+template<typename T> struct rel_ptr {
+	i64 offset = 0;//* 0 is null, a rel_ptr can't point at itself
+
+	rel_ptr() = default;
+	rel_ptr(T* ptr) { *this = ptr; }
+	rel_ptr(const rel_ptr& other) { *this = other.get(); }
+	rel_ptr& operator=(const rel_ptr& other) { return *this = other.get(); }
+	rel_ptr& operator=(T* ptr) {
+		offset = ptr != null ? i64(uintptr_t(ptr) - uintptr_t(this)) : 0;
+		return *this;
+	}
+
+	inline T* get() const { return offset != 0 ? (T*)(uintptr_t(this) + offset) : null; }
+	inline T* operator->() const { return get(); }
+	inline T& operator*() const { return *get(); }
+	inline T& operator[](u64 index) const { return get()[index]; }
+	inline operator T* () const { return get(); }
+	inline explicit operator bool() const { return offset != 0; }
+};
+
+template<typename T> struct rel_array {
+	rel_ptr<T> elements;
+	u64 count = 0;
+
+	rel_array() = default;
+	rel_array(Array<T> arr) { *this = arr; }
+	rel_array& operator=(Array<T> arr) {
+		elements = arr.data();
+		count = arr.size();
+		return *this;
+	}
+
+	inline Array<T> get() const { return carray(elements.get(), count); }
+	inline operator Array<T>() const { return get(); }
+	inline T& operator[](u64 index) const { return get()[index]; }
+	inline u64 size() const { return count; }
+	inline T* begin() const { return elements.get(); }
+	inline T* end() const { return elements.get() + count; }
+};
+
+//* file layout : header page, then the used bytes of every arena of the chain, each segment starting on a page
+//* with the same in-page offset its arena had, so the alignment of everything inside is preserved
+struct SnapshotHeader {
+	u64 magic;
+	u32 version;
+	u32 user_version;
+	u64 size;
+	u64 checksum;//* of everything after the header page
+	u64 root;//* file offset of the root object
+	u64 segment_count;
+	struct Segment {
+		u64 offset;
+		u64 size;
+	} segments[];
+
+	static constexpr u64 MAGIC = 0x50414e534c424c42ull;//* "BLBLSNAP"
+	static constexpr u32 VERSION = 1;
+	static constexpr u64 PAGE_SIZE = Arena::PAGE_SIZE_HEURISTIC;
+	static constexpr u64 MAX_SEGMENTS = (PAGE_SIZE - 48) / sizeof(Segment);
+};
+static_assert(sizeof(SnapshotHeader) == 48);
+
+struct Snapshot {
+	Buffer mapping = {};
+
+	inline SnapshotHeader& header() const { return cast<SnapshotHeader>(mapping)[0]; }
+	inline Buffer data() const { return mapping.subspan(SnapshotHeader::PAGE_SIZE); }
+	template<typename T> inline T& root() const {
+		assert(header().root + sizeof(T) <= mapping.size());
+		return cast<T>(mapping.subspan(header().root))[0];
+	}
+	inline Buffer segment(u64 index) const {
+		assert(index < header().segment_count);
+		auto& seg = header().segments[index];
+		return mapping.subspan(seg.offset, seg.size);
+	}
+};
+
+//* dumps the used bytes of arena & its chained sub arenas, root must point inside one of them
+//! rel_ptr can't reach across segments, structures meant to be saved should be built in a single arena of the chain
+bool snapshot_save(string path, const Arena& arena, const any* root, u32 user_version = 0);
+//* single copy on write mapping of the whole file, returns an empty snapshot when version or checksum don't match
+Snapshot snapshot_load(string path, u32 user_version = 0, bool verify = true);
+void snapshot_release(Snapshot& snapshot);
+
+//* in memory snapshots : an arena over shared memory can be forked into copy on write mappings of the same pages
+//* a fork costs page tables, only the pages it writes take memory, then it is either discarded or promoted into its parent
+//* the whole size is mapped up front & only written pages exist, shared arenas neither chain nor replace their vmem
+Arena arena_shared(u64 size, u64 flags = Arena::FULL_COMMIT);
+//! forks see the parent's pages until they write them, including the parent's own later writes : leave the parent alone while forks live
+//! a fork lives at another address, pointers inside the arena have to be rel_ptr to stay valid in it
+Arena arena_fork(const Arena& parent);
+void arena_discard(Arena& fork);
+//* copies the pages the fork wrote back into the parent, which takes the fork's scope, then discards the fork
+void arena_promote(Arena& parent, Arena& fork);
+
+#ifdef BLBLSTD_IMPL
+
+bool snapshot_save(string path, const Arena& arena, const any* root, u32 user_version) {
+	constexpr auto PAGE_SIZE = SnapshotHeader::PAGE_SIZE;
+	u64 size = PAGE_SIZE;
+	u64 segment_count = 0;
+	u64 root_offset = 0;
+	for (auto it = &arena; it != null && it->bytes.size() > 0; it = it->next) {
+		auto in_page = uintptr_t(it->bytes.data()) & (PAGE_SIZE - 1);
+		auto offset = size + in_page;
+		if (uintptr_t(root) >= uintptr_t(it->bytes.data()) && uintptr_t(root) < uintptr_t(it->bytes.data() + it->current))
+			root_offset = offset + (uintptr_t(root) - uintptr_t(it->bytes.data()));
+		size = (offset + it->current + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+		segment_count++;
+	}
+	if (segment_count > SnapshotHeader::MAX_SEGMENTS)
+		return fail_ret("too many segments", false);
+	if (root_offset == 0)
+		return fail_ret("root isn't in the arena", false);
+
+	auto file = map_file_mut(path, size, FileMap::SEQUENTIAL);
+	if (file.size() == 0)
+		return false;
+	defer{ unmap_file(file); };
+
+	auto& header = cast<SnapshotHeader>(file)[0];
+	header.magic = SnapshotHeader::MAGIC;
+	header.version = SnapshotHeader::VERSION;
+	header.user_version = user_version;
+	header.size = size;
+	header.root = root_offset;
+	header.segment_count = segment_count;
+	u64 offset = PAGE_SIZE;
+	u64 index = 0;
+	for (auto it = &arena; it != null && it->bytes.size() > 0; it = it->next) {
+		offset += uintptr_t(it->bytes.data()) & (PAGE_SIZE - 1);
+		header.segments[index++] = { offset, it->current };
+		memcpy(file.data() + offset, it->bytes.data(), it->current);
+		offset = (offset + it->current + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+	}
+	header.checksum = hash_bytes(file.subspan(PAGE_SIZE));
+	return true;
+}
+
+Snapshot snapshot_load(string path, u32 user_version, bool verify) {
+	Snapshot snapshot = { map_file_mut(path, 0, FileMap::PRIVATE | FileMap::WILL_NEED) };
+	if (snapshot.mapping.size() == 0)
+		return {};
+	auto& header = snapshot.header();
+	auto in_file = [&](u64 offset, u64 size) { return offset >= SnapshotHeader::PAGE_SIZE && offset <= header.size && size <= header.size - offset; };
+	auto segments_valid = [&]() {
+		if (header.segment_count > SnapshotHeader::MAX_SEGMENTS)
+			return false;
+		bool root_found = false;
+		for (auto& seg : carray(header.segments, header.segment_count)) {
+			if (!in_file(seg.offset, seg.size))
+				return false;
+			root_found |= header.root >= seg.offset && header.root < seg.offset + seg.size;
+		}
+		return root_found;
+	};
+	auto valid = (
+		snapshot.mapping.size() >= SnapshotHeader::PAGE_SIZE &&
+		header.magic == SnapshotHeader::MAGIC &&
+		header.version == SnapshotHeader::VERSION &&
+		header.user_version == user_version &&
+		header.size == snapshot.mapping.size() &&
+		segments_valid() &&//* the root has to be inside a segment, root<T>() checks that T fits
+		(!verify || header.checksum == hash_bytes(snapshot.data()))
+		);
+	if (!valid) {
+		fail_msg("invalid or outdated snapshot");
+		snapshot_release(snapshot);
+		return {};
+	}
+	return snapshot;
+}
+
+void snapshot_release(Snapshot& snapshot) {
+	unmap_file(snapshot.mapping);
+	snapshot = {};
+}
+
+Arena arena_shared(u64 size, u64 flags) {
+	flags = (flags | Arena::FULL_COMMIT) & ~(Arena::ALLOW_CHAIN_GROWTH | Arena::ALLOW_VMEM_REPLACE_GROWTH | Arena::DECOMMIT_ON_EMPTY);
+	auto fd = shared_memory_create(size);
+	if (fd < 0)
+		return {};
+	auto buffer = shared_memory_map(fd, size, false);
+	if (buffer.size() == 0) {
+		shared_memory_close(fd);
+		return {};
+	}
+	auto arena = Arena::from_buffer(Arena::poison(buffer), flags);
+	arena.fd = fd;
+	return arena;
+}
+
+Arena arena_fork(const Arena& parent) {
+	assert(parent.fd >= 0);
+	auto buffer = shared_memory_map(parent.fd, parent.bytes.size(), true);
+	if (buffer.size() == 0)
+		return {};
+	auto fork = Arena::from_buffer(buffer, parent.flags);
+	fork.fd = Arena::FORK_FD;
+	fork.current = parent.current;
+	Arena::unpoison(fork.used());
+	Arena::poison(fork.free());
+	return fork;
+}
+
+void arena_discard(Arena& fork) {
+	assert(fork.fd == Arena::FORK_FD);//* the parent owns the shared memory
+	fork.vmem_release();
+}
+
+void arena_promote(Arena& parent, Arena& fork) {
+	assert(parent.fd >= 0 && fork.bytes.size() == parent.bytes.size());
+	auto page_size = virtual_page_size();
+	auto pages = (fork.current + page_size - 1) / page_size;
+	auto [scratch, scope] = scratch_push_scope((pages + 63) / 64 * sizeof(u64));
+	defer{ scratch_pop_scope(scratch, scope); };
+	auto written = scratch.push_array<u64>((pages + 63) / 64);
+	auto known = virtual_private_pages(fork.bytes.subspan(0, min(pages * page_size, u64(fork.bytes.size()))), written);
+	Arena::unpoison(parent.bytes.subspan(0, fork.current));
+	for (auto page : u64xrange{ 0, pages }) if (!known || ((written[page / 64] >> (page % 64)) & 1)) {
+		auto start = page * page_size;
+		memcpy(parent.bytes.data() + start, fork.bytes.data() + start, min(page_size, fork.current - start));
+	}
+	parent.current = fork.current;
+	Arena::poison(parent.free());
+	arena_discard(fork);
+}
+
+#endif
+
+#endif
@@ -0,0 +1,340 @@
+#ifndef G_SORTED
+# define G_SORTED
+
+#include <utils.cpp>
+#include <arena.cpp>
+#include <list.cpp>
+#include <simd.cpp>
+#include <string.h>
+#include <type_traits>
+
+//* searches over sorted arrays, less is a strict weak ordering like std's, defaulting to <
+//* bounds are indices in [0, size], ranges are num_range used as [min, max)
+
+inline constexpr auto default_less = [](const auto& lhs, const auto& rhs) { return lhs < rhs; };
+
+//* branchless : the loop only depends on the array size, the comparison becomes a conditional move
+//* both possible next probes are prefetched so big arrays don't stall on every level
+template<typename T, typename V, typename C> u64 lower_bound(Array<T> sorted, const V& value, C less) {
+	if (sorted.size() == 0)
+		return 0;
+	auto base = sorted.data();
+	u64 n = sorted.size();
+	while (n > 1) {
+		auto half = n / 2;
+		__builtin_prefetch(base + half / 2);
+		__builtin_prefetch(base + half + half / 2);
+		base = less(base[half], value) ? base + half : base;
+		n -= half;
+	}
+	return (base - sorted.data()) + less(*base, value);
+}
+
+template<typename T, typename V, typename C> u64 upper_bound(Array<T> sorted, const V& value, C less) {
+	if (sorted.size() == 0)
+		return 0;
+	auto base = sorted.data();
+	u64 n = sorted.size();
+	while (n > 1) {
+		auto half = n / 2;
+		__builtin_prefetch(base + half / 2);
+		__builtin_prefetch(base + half + half / 2);
+		base = !less(value, base[half]) ? base + half : base;
+		n -= half;
+	}
+	return (base - sorted.data()) + !less(value, *base);
+}
+
+template<typename T, typename V, typename C> num_range<u64> equal_range(Array<T> sorted, const V& value, C less) {
+	auto first = lower_bound(sorted, value, less);
+	return { first, first + upper_bound(sorted.subspan(first), value, less) };
+}
+
+template<typename T, typename V> u64 lower_bound(Array<T> sorted, const V& value) { return lower_bound(sorted, value, default_less); }
+template<typename T, typename V> u64 upper_bound(Array<T> sorted, const V& value) { return upper_bound(sorted, value, default_less); }
+template<typename T, typename V> num_range<u64> equal_range(Array<T> sorted, const V& value) { return equal_range(sorted, value, default_less); }
+
+template<typename T, typename V> i64 binary_search(Array<T> sorted, const V& value) {
+	auto index = lower_bound(sorted, value);
+	return (index < sorted.size() && !(value < sorted[index])) ? i64(index) : -1;
+}
+
+//* Eytzinger (bfs) layout : node k has children 2k & 2k + 1, index 0 is unused
+//* the top levels of the tree share a handful of cache lines, and the descent is a prefetchable sequence
+template<typename T> Array<T> eytzinger_layout(Arena& arena, Array<const T> sorted) {
+	auto tree = arena.push_array<T>(sorted.size() + 1);
+	u64 next = 0;
+	auto fill = [&](auto& self, u64 k) -> void {
+		if (k > sorted.size()) return;
+		self(self, 2 * k);
+		tree[k] = sorted[next++];
+		self(self, 2 * k + 1);
+	};
+	fill(fill, 1);
+	return tree;
+}
+
+template<typename T> Array<T> eytzinger_layout(Arena& arena, Array<T> sorted) { return eytzinger_layout(arena, Array<const T>(sorted)); }
+
+//* tree index of the first element not less than value, 0 when there is none
+template<typename T, typename V, typename C> u64 eytzinger_lower_bound(Array<T> tree, const V& value, C less) {
+	constexpr u64 PER_LINE = max(u64(1), 64 / sizeof(T));
+	u64 k = 1;
+	while (k < tree.size()) {
+		__builtin_prefetch(tree.data() + min(k * PER_LINE, tree.size() - 1));
+		k = 2 * k + less(tree[k], value);
+	}
+	return k >> ffs(~k);//* undo the right turns taken after the last left one
+}
+
+//* tree index of the first element greater than value, 0 when there is none
+template<typename T, typename V, typename C> u64 eytzinger_upper_bound(Array<T> tree, const V& value, C less) {
+	constexpr u64 PER_LINE = max(u64(1), 64 / sizeof(T));
+	u64 k = 1;
+	while (k < tree.size()) {
+		__builtin_prefetch(tree.data() + min(k * PER_LINE, tree.size() - 1));
+		k = 2 * k + !less(value, tree[k]);
+	}
+	return k >> ffs(~k);
+}
+
+//* tree index of the element following k in sorted order, 0 after the last one
+template<typename T> u64 eytzinger_next(Array<T> tree, u64 k) {
+	if (2 * k + 1 < tree.size()) {//* leftmost node of the right subtree
+		k = 2 * k + 1;
+		while (2 * k < tree.size())
+			k = 2 * k;
+		return k;
+	}
+	return k >> ffs(~k);//* up to the first ancestor k is on the left of
+}
+
+//* tree indices [min, max) of the elements equal to value, walked with eytzinger_next, max is 0 when they run to the end
+template<typename T, typename V, typename C> num_range<u64> eytzinger_equal_range(Array<T> tree, const V& value, C less) {
+	auto first = eytzinger_lower_bound(tree, value, less);
+	if (first == 0 || less(value, tree[first]))
+		return { first, first };
+	return { first, eytzinger_upper_bound(tree, value, less) };
+}
+
+template<typename T, typename V> u64 eytzinger_lower_bound(Array<T> tree, const V& value) { return eytzinger_lower_bound(tree, value, default_less); }
+template<typename T, typename V> u64 eytzinger_upper_bound(Array<T> tree, const V& value) { return eytzinger_upper_bound(tree, value, default_less); }
+template<typename T, typename V> num_range<u64> eytzinger_equal_range(Array<T> tree, const V& value) { return eytzinger_equal_range(tree, value, default_less); }
+
+//* first index from start on where before is false, before must hold on a prefix of the array & fail on the rest
+//* probes start + 1, 3, 7... then binary searches the last step, O(log d) for an answer d away from start
+template<typename T> u64 gallop(Array<T> sorted, u64 start, auto before) {
+	if (start >= sorted.size() || !before(sorted[start]))
+		return start;
+	u64 low = start;
+	u64 step = 1;
+	while (low + step < sorted.size() && before(sorted[low + step])) {
+		low += step;
+		step *= 2;
+	}
+	u64 high = min(low + step, u64(sorted.size()));
+	low++;
+	while (low < high) {
+		auto middle = low + (high - low) / 2;
+		if (before(sorted[middle]))
+			low = middle + 1;
+		else
+			high = middle;
+	}
+	return low;
+}
+
+//* set operations : inputs are sorted by less & hold no duplicates, run unique on them first otherwise
+//* merges are linear, when one side is over GALLOP_RATIO times smaller its elements gallop through the other instead
+//* outputs are pushed on the arena at their upper bound size & shrunk to what was written
+constexpr u64 GALLOP_RATIO = 32;
+
+template<typename T> concept simd_set_element = std::is_integral_v<T> && (sizeof(T) == 4 || sizeof(T) == 8);
+template<typename C> concept natural_less = std::is_same_v<std::remove_cvref_t<C>, std::remove_cvref_t<decltype(default_less)>>;
+
+//* keeps the first element of each run of equal ones, in place, returns the kept prefix
+template<typename T, typename C> Array<T> unique(Array<T> sorted, C less) {
+	if (sorted.size() == 0)
+		return sorted;
+	u64 kept = 1;
+	for (auto i : u64xrange{ 1, sorted.size() }) if (less(sorted[kept - 1], sorted[i]))
+		sorted[kept++] = sorted[i];
+	return sorted.subspan(0, kept);
+}
+
+template<typename T, typename C> Array<std::remove_cv_t<T>> unique(Arena& arena, Array<T> sorted, C less) {
+	auto kept = List{ arena.push_array<std::remove_cv_t<T>>(sorted.size()), 0 };
+	for (auto i : u64xrange{ 0, sorted.size() }) if (i == 0 || less(kept.used().back(), sorted[i]))
+		kept.push(sorted[i]);
+	return kept.shrink_to_content(arena);
+}
+
+//* a vector of a against each key of the b block splatted, then whichever block ends lower moves on, both when they end on the same key
+//* returns the count written to out & leaves i, j where the blocks stopped for the scalar tail
+template<typename T> u64 simd_intersect(const T* a, u64 n, u64& i, const T* b, u64 m, u64& j, T* out) {
+	typedef T V __attribute__((vector_size(SIMD_WIDTH)));
+	constexpr u64 LANES = SIMD_WIDTH / sizeof(T);
+	u64 count = 0;
+	while (i + LANES <= n && j + LANES <= m) {
+		V keys;
+		memcpy(&keys, a + i, sizeof(keys));
+		auto hits = keys != keys;
+		for (auto k : u64xrange{ 0, LANES })
+			hits |= keys == b[j + k];
+		for (auto k : u64xrange{ 0, LANES }) if (hits[k])
+			out[count++] = a[i + k];
+		auto last_a = a[i + LANES - 1];
+		auto last_b = b[j + LANES - 1];
+		i += last_a <= last_b ? LANES : 0;
+		j += last_b <= last_a ? LANES : 0;
+	}
+	return count;
+}
+
+//* like set_union, the elements kept are the ones from a
+template<typename T, typename C> Array<T> set_intersection(Arena& arena, Array<const T> a, Array<const T> b, C less) {
+	auto out = List{ arena.push_array<T>(min(a.size(), b.size())), 0 };
+	u64 i = 0, j = 0;
+	if (a.size() * GALLOP_RATIO < b.size()) {
+		for (auto&& x : a) {
+			j = gallop(b, j, [&](const T& e) { return less(e, x); });
+			if (j == b.size())
+				break;
+			if (!less(x, b[j])) {
+				out.push(x);
+				j++;
+			}
+		}
+		return out.shrink_to_content(arena);
+	} else if (b.size() * GALLOP_RATIO < a.size()) {
+		for (auto&& y : b) {
+			i = gallop(a, i, [&](const T& e) { return less(e, y); });
+			if (i == a.size())
+				break;
+			if (!less(y, a[i]))
+				out.push(a[i++]);
+		}
+		return out.shrink_to_content(arena);
+	}
+	if constexpr (simd_set_element<T> && natural_less<C>)
+		out.current = simd_intersect(a.data(), a.size(), i, b.data(), b.size(), j, out.capacity.data());
+	while (i < a.size() && j < b.size()) {
+		if (less(a[i], b[j]))
+			i++;
+		else if (less(b[j], a[i]))
+			j++;
+		else {
+			out.push(a[i]);
+			i++;
+			j++;
+		}
+	}
+	return out.shrink_to_content(arena);
+}
+
+//* on equal elements the one from a is kept
+template<typename T, typename C> Array<T> set_union(Arena& arena, Array<const T> a, Array<const T> b, C less) {
+	auto out = List{ arena.push_array<T>(a.size() + b.size()), 0 };
+	u64 i = 0, j = 0;
+	if (a.size() * GALLOP_RATIO < b.size() || b.size() * GALLOP_RATIO < a.size()) {
+		auto small_first = a.size() < b.size();
+		auto small = small_first ? a : b;
+		auto large = small_first ? b : a;
+		for (auto&& x : small) {
+			auto k = gallop(large, j, [&](const T& e) { return less(e, x); });
+			out.push(large.subspan(j, k - j));
+			j = k;
+			auto equal = j < large.size() && !less(x, large[j]);
+			out.push(equal && !small_first ? large[j] : x);
+			j += equal;
+		}
+		out.push(large.subspan(j));
+		return out.shrink_to_content(arena);
+	}
+	while (i < a.size() && j < b.size()) {
+		if (less(b[j], a[i]))
+			out.push(b[j++]);
+		else {
+			j += !less(a[i], b[j]);
+			out.push(a[i++]);
+		}
+	}
+	out.push(a.subspan(i));
+	out.push(b.subspan(j));
+	return out.shrink_to_content(arena);
+}
+
+//* elements of a that are not in b
+template<typename T, typename C> Array<T> set_difference(Arena& arena, Array<const T> a, Array<const T> b, C less) {
+	auto out = List{ arena.push_array<T>(a.size()), 0 };
+	u64 i = 0, j = 0;
+	if (b.size() * GALLOP_RATIO < a.size()) {//* few holes : copy the runs of a between them
+		for (auto&& y : b) {
+			auto k = gallop(a, i, [&](const T& e) { return less(e, y); });
+			out.push(a.subspan(i, k - i));
+			i = k;
+			i += i < a.size() && !less(y, a[i]);
+		}
+		out.push(a.subspan(i));
+	} else if (a.size() * GALLOP_RATIO < b.size()) {
+		for (auto&& x : a) {
+			j = gallop(b, j, [&](const T& e) { return less(e, x); });
+			if (j == b.size() || less(x, b[j]))
+				out.push(x);
+		}
+	} else {
+		while (i < a.size() && j < b.size()) {
+			if (less(a[i], b[j]))
+				out.push(a[i++]);
+			else {
+				i += !less(b[j], a[i]);
+				j++;
+			}
+		}
+		out.push(a.subspan(i));
+	}
+	return out.shrink_to_content(arena);
+}
+
+template<typename T> Array<T> unique(Array<T> sorted) { return unique(sorted, default_less); }
+template<typename T> Array<std::remove_cv_t<T>> unique(Arena& arena, Array<T> sorted) { return unique(arena, sorted, default_less); }
+template<typename T, typename C> Array<T> set_intersection(Arena& arena, Array<T> a, Array<T> b, C less) { return set_intersection(arena, Array<const T>(a), Array<const T>(b), less); }
+template<typename T, typename C> Array<T> set_union(Arena& arena, Array<T> a, Array<T> b, C less) { return set_union(arena, Array<const T>(a), Array<const T>(b), less); }
+template<typename T, typename C> Array<T> set_difference(Arena& arena, Array<T> a, Array<T> b, C less) { return set_difference(arena, Array<const T>(a), Array<const T>(b), less); }
+template<typename T> Array<std::remove_cv_t<T>> set_intersection(Arena& arena, Array<T> a, Array<T> b) { return set_intersection(arena, Array<const std::remove_cv_t<T>>(a), Array<const std::remove_cv_t<T>>(b), default_less); }
+template<typename T> Array<std::remove_cv_t<T>> set_union(Arena& arena, Array<T> a, Array<T> b) { return set_union(arena, Array<const std::remove_cv_t<T>>(a), Array<const std::remove_cv_t<T>>(b), default_less); }
+template<typename T> Array<std::remove_cv_t<T>> set_difference(Arena& arena, Array<T> a, Array<T> b) { return set_difference(arena, Array<const std::remove_cv_t<T>>(a), Array<const std::remove_cv_t<T>>(b), default_less); }
+
+//* inner join of two arrays sorted by key, keys only need <
+//* returns the (left, right) index pairs of every matching couple, equal key runs give their cross product
+//* a side over GALLOP_RATIO times larger than the other gallops past its unmatched keys
+template<typename L, typename R> Array<tuple<u64, u64>> merge_join(Arena& arena, Array<L> left, Array<R> right, auto key_l, auto key_r) {
+	auto matches = List<tuple<u64, u64>>{ {}, 0 };
+	auto gallop_left = right.size() * GALLOP_RATIO < left.size();
+	auto gallop_right = left.size() * GALLOP_RATIO < right.size();
+	u64 i = 0, j = 0;
+	while (i < left.size() && j < right.size()) {
+		auto kl = key_l(left[i]);
+		auto kr = key_r(right[j]);
+		if (kl < kr)
+			i = gallop_left ? gallop(left, i, [&](const L& e) { return key_l(e) < kr; }) : i + 1;
+		else if (kr < kl)
+			j = gallop_right ? gallop(right, j, [&](const R& e) { return key_r(e) < kl; }) : j + 1;
+		else {
+			auto left_end = i + 1;
+			while (left_end < left.size() && !(kl < key_l(left[left_end])))
+				left_end++;
+			auto right_end = j + 1;
+			while (right_end < right.size() && !(kr < key_r(right[right_end])))
+				right_end++;
+			matches.grow(arena, (left_end - i) * (right_end - j));
+			for (auto l : u64xrange{ i, left_end }) for (auto r : u64xrange{ j, right_end })
+				matches.push(tuple<u64, u64>(l, r));
+			i = left_end;
+			j = right_end;
+		}
+	}
+	return matches.shrink_to_content(arena);
+}
+
+#endif
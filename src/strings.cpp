@@ -0,0 +1,178 @@
+#ifndef G_STRINGS
+# define G_STRINGS
+
+#include <simd.cpp>
+#include <list.cpp>
+#include <arena.cpp>
+
+//* every search returns the index of the match in str, or -1, like linear_search
+
+//* set of up to 256 bytes, small sets are matched a vector at a time, bigger ones through the table
+struct ByteSet {
+	static constexpr u64 MAX_VECTOR_COUNT = 8;
+	simd_bytes splats[MAX_VECTOR_COUNT];
+	u64 count = 0;
+	u64 table[4] = {};
+	char first = 0;
+
+	ByteSet(string bytes) {
+		for (auto c : bytes) {
+			auto b = u8(c);
+			if (has_one(table[b / 64], bit<u64>(b % 64)))
+				continue;
+			table[b / 64] |= bit<u64>(b % 64);
+			if (count == 0)
+				first = c;
+			if (count < MAX_VECTOR_COUNT)
+				splats[count] = simd_splat(b);
+			count++;
+		}
+	}
+
+	inline bool contains(char c) const { return has_one(table[u8(c) / 64], bit<u64>(u8(c) % 64)); }
+	inline simd_mask match(simd_bytes block) const {
+		simd_mask mask = 0;
+		for (auto i : u64xrange{ 0, count })
+			mask |= simd_eq_mask(block, splats[i]);
+		return mask;
+	}
+};
+
+i64 find_byte(string str, char c, u64 start = 0);
+i64 find_any_of(string str, const ByteSet& set, u64 start = 0);
+inline i64 find_any_of(string str, string set, u64 start = 0) { return find_any_of(str, ByteSet(set), start); }
+i64 find(string str, string needle, u64 start = 0);
+
+inline bool is_whitespace(char c) { return c == ' ' || (c >= '\t' && c <= '\r'); }
+string trim_left(string str);
+string trim_right(string str);
+inline string trim(string str) { return trim_right(trim_left(str)); }
+
+//* calls on_token for every token separated by any of delims, returns the token count
+template<typename F> u64 split(string str, const ByteSet& delims, F on_token, bool skip_empty = false) {
+	u64 count = 0;
+	u64 start = 0;
+	while (start <= str.size()) {
+		auto found = find_any_of(str, delims, start);
+		u64 end = found < 0 ? str.size() : found;
+		if (!skip_empty || end > start) {
+			on_token(str.substr(start, end - start));
+			count++;
+		}
+		start = end + 1;
+	}
+	return count;
+}
+
+template<typename F> u64 split(string str, string delims, F on_token, bool skip_empty = false) {
+	return split(str, ByteSet(delims), on_token, skip_empty);
+}
+
+inline Array<string> split(Arena& arena, string str, string delims, bool skip_empty = false) {
+	auto tokens = List<string>{ {}, 0 };
+	split(str, delims, [&](string token) { tokens.push_growing(arena, token); }, skip_empty);
+	return tokens.shrink_to_content(arena);
+}
+
+//* lines without their \n or \r\n terminator, a trailing terminator doesn't produce an empty last line
+struct line_iterator {
+	string str;
+	string line;
+	u64 next;
+
+	inline void find_line() {
+		if (next >= str.size()) {
+			line = {};
+			return;
+		}
+		auto found = find_byte(str, '\n', next);
+		u64 end = found < 0 ? str.size() : found;
+		line = str.substr(next, end - next);
+		if (line.size() > 0 && line.back() == '\r')
+			line.remove_suffix(1);
+		next = end + 1;
+	}
+
+	auto& operator++() { find_line(); return *this; }
+	string operator*() const { return line; }
+	bool operator!=(const line_iterator& rhs) const { return line.data() != rhs.line.data(); }
+};
+
+inline it_range<line_iterator> iter_lines(string str) {
+	line_iterator it = { str, {}, 0 };
+	if (str.size() > 0)
+		it.find_line();
+	return { it, line_iterator{ str, {}, str.size() } };
+}
+
+#ifdef BLBLSTD_IMPL
+
+i64 find_byte(string str, char c, u64 start) {
+	auto data = (const u8*)str.data();
+	auto target = simd_splat(c);
+	u64 i = start;
+	for (; i + SIMD_WIDTH <= str.size(); i += SIMD_WIDTH) {
+		auto mask = simd_eq_mask(simd_load(data + i), target);
+		if (mask != 0)
+			return i + ctz(mask);
+	}
+	for (; i < str.size(); i++) if (str[i] == c)
+		return i;
+	return -1;
+}
+
+i64 find_any_of(string str, const ByteSet& set, u64 start) {
+	if (set.count <= 1)
+		return set.count == 0 ? -1 : find_byte(str, set.first, start);
+	auto data = (const u8*)str.data();
+	u64 i = start;
+	if (set.count <= ByteSet::MAX_VECTOR_COUNT) for (; i + SIMD_WIDTH <= str.size(); i += SIMD_WIDTH) {
+		auto mask = set.match(simd_load(data + i));
+		if (mask != 0)
+			return i + ctz(mask);
+	}
+	for (; i < str.size(); i++) if (set.contains(str[i]))
+		return i;
+	return -1;
+}
+
+//* vector filter on the first & last byte of the needle, only candidates matching both get compared
+i64 find(string str, string needle, u64 start) {
+	if (needle.size() == 0)
+		return start <= str.size() ? i64(start) : -1;
+	if (needle.size() == 1)
+		return find_byte(str, needle[0], start);
+	if (needle.size() > str.size())
+		return -1;
+	auto data = (const u8*)str.data();
+	auto first = simd_splat(needle.front());
+	auto last = simd_splat(needle.back());
+	auto last_offset = needle.size() - 1;
+	u64 i = start;
+	for (; i + last_offset + SIMD_WIDTH <= str.size(); i += SIMD_WIDTH) {
+		auto mask = simd_eq_mask(simd_load(data + i), first) & simd_eq_mask(simd_load(data + i + last_offset), last);
+		for (; mask != 0; mask &= mask - 1) {
+			auto candidate = i + ctz(mask);
+			if (memcmp(data + candidate + 1, needle.data() + 1, needle.size() - 2) == 0)
+				return candidate;
+		}
+	}
+	auto found = str.find(needle, i);
+	return found == string::npos ? -1 : i64(found);
+}
+
+string trim_left(string str) {
+	u64 i = 0;
+	while (i < str.size() && is_whitespace(str[i])) i++;
+	return str.substr(i);
+}
+
+string trim_right(string str) {
+	u64 size = str.size();
+	while (size > 0 && is_whitespace(str[size - 1])) size--;
+	return str.substr(0, size);
+}
+
+#endif
+
+#endif
@@ -0,0 +1,188 @@
+#ifndef G_TIMER_WHEEL
+# define G_TIMER_WHEEL
+
+#include <utils.cpp>
+#include <list.cpp>
+#include <arena.cpp>
+#include <string.h>
+
+//* hierarchical timing wheel over integer ticks : LEVELS wheels of SLOTS buckets, level k covers SLOT_BITS * k bits of the deadline
+//* a timer sits at the level of the highest digit where its deadline differs from now & cascades down when now reaches that digit
+//* deadlines further than 2^(SLOT_BITS * LEVELS) ticks wait in an overflow bucket, rescanned when the top wheel wraps
+//* timers are linked by index so the node List can grow through morph_array, handles carry a generation so cancel after expiry is a no-op
+//* per wheel occupancy bits let advance jump straight to the next tick where something fires or cascades
+template<typename T> struct TimerWheel {
+	static constexpr u32 SLOT_BITS = 8;
+	static constexpr u32 SLOTS = 1u << SLOT_BITS;
+	static constexpr u32 LEVELS = 4;
+	static constexpr u32 BUCKETS = SLOTS * LEVELS + 1;
+	static constexpr u32 OVERFLOW_BUCKET = SLOTS * LEVELS;
+	static constexpr u32 NONE = ~0u;
+
+	struct Timer {
+		T value;
+		u64 deadline;
+		u32 previous;
+		u32 next;//* next free timer while unused
+		u32 bucket;//* NONE while unused
+		u32 generation;
+	};
+
+	List<Timer> timers;
+	u32 heads[BUCKETS];
+	u64 occupied[LEVELS][SLOTS / 64];
+	u32 free_timer = NONE;
+	u64 now = 0;
+	u64 count = 0;
+
+	static TimerWheel make(u64 start = 0) {
+		TimerWheel wheel = {};
+		memset(wheel.occupied, 0, sizeof(wheel.occupied));
+		for (auto& head : wheel.heads)
+			head = NONE;
+		wheel.now = start;
+		return wheel;
+	}
+
+	static inline u64 handle_of(u32 index, u32 generation) { return u64(index) | (u64(generation) << 32); }
+
+	//* earliest is now + 1 when scheduling, already due timers fire on the next tick
+	//* & now when cascading, timers due this tick go to the current level 0 bucket, drained right after the cascades
+	void link(u32 index, u64 earliest) {
+		auto& timer = timers[index];
+		auto at = max(timer.deadline, earliest);
+		auto differing = at ^ now;
+		auto level = differing == 0 ? 0 : (63 - __builtin_clzll(differing)) / SLOT_BITS;
+		timer.bucket = level >= LEVELS ? OVERFLOW_BUCKET : level * SLOTS + ((at >> (level * SLOT_BITS)) & (SLOTS - 1));
+		timer.previous = NONE;
+		timer.next = heads[timer.bucket];
+		if (timer.next != NONE)
+			timers[timer.next].previous = index;
+		heads[timer.bucket] = index;
+		if (timer.bucket != OVERFLOW_BUCKET)
+			occupied[timer.bucket / SLOTS][timer.bucket % SLOTS / 64] |= bit<u64>(timer.bucket % 64);
+	}
+
+	inline void clear_bucket(u32 bucket) {
+		heads[bucket] = NONE;
+		if (bucket != OVERFLOW_BUCKET)
+			occupied[bucket / SLOTS][bucket % SLOTS / 64] &= ~bit<u64>(bucket % 64);
+	}
+
+	void unlink(u32 index) {
+		auto& timer = timers[index];
+		if (timer.previous != NONE)
+			timers[timer.previous].next = timer.next;
+		else if (timer.next == NONE)
+			clear_bucket(timer.bucket);
+		else
+			heads[timer.bucket] = timer.next;
+		if (timer.next != NONE)
+			timers[timer.next].previous = timer.previous;
+	}
+
+	void release(u32 index) {
+		auto& timer = timers[index];
+		timer.bucket = NONE;
+		timer.generation++;
+		timer.next = free_timer;
+		free_timer = index;
+		count--;
+	}
+
+	u64 schedule(Arena& arena, u64 deadline, const T& value) {
+		u32 index = free_timer;
+		if (index != NONE) {
+			free_timer = timers[index].next;
+		} else {
+			timers.grow(arena);
+			index = timers.current++;
+			timers[index].generation = 0;
+		}
+		timers[index].value = value;
+		timers[index].deadline = deadline;
+		link(index, now + 1);
+		count++;
+		return handle_of(index, timers[index].generation);
+	}
+
+	//* false when the timer already fired or was cancelled
+	bool cancel(u64 handle) {
+		u32 index = handle;
+		if (index >= timers.current || timers[index].generation != u32(handle >> 32) || timers[index].bucket == NONE)
+			return false;
+		unlink(index);
+		release(index);
+		return true;
+	}
+
+	void cascade(u32 bucket) {
+		auto index = heads[bucket];
+		clear_bucket(bucket);
+		while (index != NONE) {
+			auto next = timers[index].next;
+			link(index, now);
+			index = next;
+		}
+	}
+
+	//* first occupied slot of level from slot start, -1 when there is none
+	i64 next_slot(u32 level, u32 start) const {
+		for (u32 word = start / 64; word < SLOTS / 64; word++) {
+			auto bits = occupied[level][word] & (word == start / 64 ? ~u64(0) << (start % 64) : ~u64(0));
+			if (bits)
+				return word * 64 + ctz(bits);
+		}
+		return -1;
+	}
+
+	//* next tick that fires timers or cascades a non empty slot, timers always sit ahead of now's digit at their level
+	u64 next_event() const {
+		u64 next = ~u64(0);
+		for (auto level : u32xrange{ 0, LEVELS }) {
+			auto shift = level * SLOT_BITS;
+			auto digit = (now >> shift) & (SLOTS - 1);
+			if (digit + 1 >= SLOTS)
+				continue;
+			auto slot = next_slot(level, digit + 1);
+			if (slot >= 0)
+				next = min(next, (now & ~((u64(1) << (shift + SLOT_BITS)) - 1)) | (u64(slot) << shift));
+		}
+		if (heads[OVERFLOW_BUCKET] != NONE)
+			next = min(next, ((now >> (LEVELS * SLOT_BITS)) + 1) << (LEVELS * SLOT_BITS));
+		return next;
+	}
+
+	//* moves now up to target & returns the values of every timer with a deadline <= target, in no particular order
+	Array<T> advance(Arena& arena, u64 target) {
+		auto expired = List<T>{ {}, 0 };
+		while (now < target) {
+			auto next = count == 0 ? ~u64(0) : next_event();
+			if (next > target) {
+				now = target;
+				break;
+			}
+			now = next;
+			u32 level = 1;
+			while (level < LEVELS && (now & ((u64(1) << (level * SLOT_BITS)) - 1)) == 0)
+				level++;
+			if (level == LEVELS && (now & ((u64(1) << (LEVELS * SLOT_BITS)) - 1)) == 0)
+				cascade(OVERFLOW_BUCKET);
+			while (--level > 0)//* higher wheels first, their timers may land in the lower ones
+				cascade(level * SLOTS + ((now >> (level * SLOT_BITS)) & (SLOTS - 1)));
+			auto bucket = now & (SLOTS - 1);
+			auto index = heads[bucket];
+			clear_bucket(bucket);
+			while (index != NONE) {
+				auto following = timers[index].next;
+				expired.grow(arena);
+				expired.push(timers[index].value);
+				release(index);
+				index = following;
+			}
+		}
+		return expired.used();
+	}
+};
+
+#endif
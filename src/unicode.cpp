@@ -0,0 +1,285 @@
+#ifndef G_UNICODE
+# define G_UNICODE
+
+#include <simd.cpp>
+#include <arena.cpp>
+
+//* validation & transcoding between utf8, utf16 & utf32
+//* conversions run an exact size pass first (which is also the validation) so the output is pushed once at its final size
+//* runs of ascii are checked & copied a block at a time, utf8 is validated a whole vector at a time when the target has byte shuffles
+
+constexpr u32 UTF_INVALID = ~0u;
+
+inline u32 utf_decode(const char8_t* str, u64 size, u64& i) {
+	u8 b0 = str[i];
+	if (b0 < 0x80) {
+		i++;
+		return b0;
+	}
+	auto cont = [&](u64 offset, u8 low = 0x80, u8 high = 0xbf) { return i + offset < size && u8(str[i + offset]) >= low && u8(str[i + offset]) <= high; };
+	auto bits = [&](u64 offset) { return u32(str[i + offset] & 0x3f); };
+	u32 cp = UTF_INVALID;
+	if (b0 < 0xc2) {//* stray continuation or overlong 2 bytes
+		return UTF_INVALID;
+	} else if (b0 < 0xe0) {
+		if (!cont(1)) return UTF_INVALID;
+		cp = (u32(b0 & 0x1f) << 6) | bits(1);
+		i += 2;
+	} else if (b0 < 0xf0) {
+		if (!cont(1, b0 == 0xe0 ? 0xa0 : 0x80, b0 == 0xed ? 0x9f : 0xbf) || !cont(2)) return UTF_INVALID;//* overlongs & surrogates
+		cp = (u32(b0 & 0x0f) << 12) | (bits(1) << 6) | bits(2);
+		i += 3;
+	} else if (b0 < 0xf5) {
+		if (!cont(1, b0 == 0xf0 ? 0x90 : 0x80, b0 == 0xf4 ? 0x8f : 0xbf) || !cont(2) || !cont(3)) return UTF_INVALID;//* overlongs & > U+10FFFF
+		cp = (u32(b0 & 0x07) << 18) | (bits(1) << 12) | (bits(2) << 6) | bits(3);
+		i += 4;
+	}
+	return cp;
+}
+
+inline u32 utf_decode(const char16_t* str, u64 size, u64& i) {
+	u32 u0 = str[i];
+	if (u0 < 0xd800 || u0 > 0xdfff) {
+		i++;
+		return u0;
+	}
+	if (u0 > 0xdbff || i + 1 >= size || str[i + 1] < 0xdc00 || str[i + 1] > 0xdfff)
+		return UTF_INVALID;//* unpaired surrogate
+	u32 cp = 0x10000 + ((u0 - 0xd800) << 10) + (str[i + 1] - 0xdc00);
+	i += 2;
+	return cp;
+}
+
+inline u32 utf_decode(const char32_t* str, u64, u64& i) {
+	u32 cp = str[i++];
+	return (cp > 0x10ffff || (cp >= 0xd800 && cp <= 0xdfff)) ? UTF_INVALID : cp;
+}
+
+template<typename C> inline u32 utf_units(u32 cp);
+template<> inline u32 utf_units<char8_t>(u32 cp) { return cp < 0x80 ? 1 : cp < 0x800 ? 2 : cp < 0x10000 ? 3 : 4; }
+template<> inline u32 utf_units<char16_t>(u32 cp) { return cp < 0x10000 ? 1 : 2; }
+template<> inline u32 utf_units<char32_t>(u32) { return 1; }
+
+inline u32 utf_encode(u32 cp, char8_t* out) {
+	if (cp < 0x80) {
+		out[0] = cp;
+		return 1;
+	} else if (cp < 0x800) {
+		out[0] = 0xc0 | (cp >> 6);
+		out[1] = 0x80 | (cp & 0x3f);
+		return 2;
+	} else if (cp < 0x10000) {
+		out[0] = 0xe0 | (cp >> 12);
+		out[1] = 0x80 | ((cp >> 6) & 0x3f);
+		out[2] = 0x80 | (cp & 0x3f);
+		return 3;
+	} else {
+		out[0] = 0xf0 | (cp >> 18);
+		out[1] = 0x80 | ((cp >> 12) & 0x3f);
+		out[2] = 0x80 | ((cp >> 6) & 0x3f);
+		out[3] = 0x80 | (cp & 0x3f);
+		return 4;
+	}
+}
+
+inline u32 utf_encode(u32 cp, char16_t* out) {
+	if (cp < 0x10000) {
+		out[0] = cp;
+		return 1;
+	}
+	cp -= 0x10000;
+	out[0] = 0xd800 + (cp >> 10);
+	out[1] = 0xdc00 + (cp & 0x3ff);
+	return 2;
+}
+
+inline u32 utf_encode(u32 cp, char32_t* out) {
+	out[0] = cp;
+	return 1;
+}
+
+template<typename C> constexpr u64 UTF_ASCII_BLOCK = sizeof(C) == 1 ? SIMD_WIDTH : 16;
+
+template<typename C> inline bool utf_ascii_block(const C* str) {
+	if constexpr (sizeof(C) == 1) {
+		return simd_high_bits(simd_load(str)) == 0;
+	} else {
+		C acc = 0;//* or reduction, vectorizes
+		for (auto i : u64xrange{ 0, UTF_ASCII_BLOCK<C> })
+			acc |= str[i];
+		return acc < 0x80;
+	}
+}
+
+//* Keiser & Lemire lookup validation : each byte is classified from both nibbles of the byte before it & its own high nibble,
+//* 3 table lookups whose and is the error bits of that pair, then 3 & 4 byte sequences are checked against the bytes 2 & 3 back
+//* the only state carried across blocks is the previous block & whether it ended in the middle of a sequence
+namespace utf8_lookup {
+	constexpr u8 TOO_SHORT = 1 << 0;//* lead not followed by a continuation
+	constexpr u8 TOO_LONG = 1 << 1;//* ascii followed by a continuation
+	constexpr u8 OVERLONG_3 = 1 << 2;
+	constexpr u8 TOO_LARGE = 1 << 3;
+	constexpr u8 SURROGATE = 1 << 4;
+	constexpr u8 OVERLONG_2 = 1 << 5;
+	constexpr u8 TOO_LARGE_1000 = 1 << 6;
+	constexpr u8 OVERLONG_4 = 1 << 6;
+	constexpr u8 TWO_CONTS = 1 << 7;//* continuation after a continuation, only valid in 3 & 4 byte sequences
+	constexpr u8 CARRY = TOO_SHORT | TOO_LONG | TWO_CONTS;//* only depend on the high nibble of the first byte
+
+	constexpr u8 byte_1_high[16] = {
+		TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,//* 0___
+		TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,//* 10__
+		TOO_SHORT | OVERLONG_2,//* 1100
+		TOO_SHORT,//* 1101
+		TOO_SHORT | OVERLONG_3 | SURROGATE,//* 1110
+		TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4,//* 1111
+	};
+	constexpr u8 byte_1_low[16] = {
+		CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,//* 0000
+		CARRY | OVERLONG_2,//* 0001
+		CARRY, CARRY,//* 001_
+		CARRY | TOO_LARGE,//* 0100
+		CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000,//* 0101 & 011_
+		CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000,//* 10__
+		CARRY | TOO_LARGE | TOO_LARGE_1000,//* 1100
+		CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,//* 1101
+		CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000,//* 111_
+	};
+	constexpr u8 byte_2_high[16] = {
+		TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,//* 0___
+		TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4,//* 1000
+		TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,//* 1001
+		TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE, TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,//* 101_
+		TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,//* 11__
+	};
+}
+
+struct Utf8Validator {
+	simd_bytes byte_1_high = simd_table16(utf8_lookup::byte_1_high);
+	simd_bytes byte_1_low = simd_table16(utf8_lookup::byte_1_low);
+	simd_bytes byte_2_high = simd_table16(utf8_lookup::byte_2_high);
+	simd_bytes low_nibble = simd_splat(0x0f);
+	simd_bytes incomplete_limits;//* a lead in the last 3 lanes whose sequence doesn't fit in them is above its limit
+	simd_bytes previous = simd_splat(0);
+	simd_bytes previous_incomplete = simd_splat(0);
+	simd_bytes error = simd_splat(0);
+
+	Utf8Validator() {
+		u8 limits[SIMD_WIDTH];
+		memset(limits, 0xff, SIMD_WIDTH);
+		limits[SIMD_WIDTH - 3] = 0xf0 - 1;
+		limits[SIMD_WIDTH - 2] = 0xe0 - 1;
+		limits[SIMD_WIDTH - 1] = 0xc0 - 1;
+		incomplete_limits = simd_load(limits);
+	}
+
+	inline void block(simd_bytes input) {
+		if (simd_high_bits(input) == 0) {//* ascii, only has to complete the previous block
+			error = simd_or(error, previous_incomplete);
+		} else {
+			auto prev1 = simd_prev<1>(input, previous);
+			auto special = simd_and(simd_and(
+				simd_lookup16(byte_1_high, simd_high_nibbles(prev1)),
+				simd_lookup16(byte_1_low, simd_and(prev1, low_nibble))),
+				simd_lookup16(byte_2_high, simd_high_nibbles(input)));
+			auto third = simd_sub_sat(simd_prev<2>(input, previous), simd_splat(0xe0 - 0x80));//* high bit set for 111_____
+			auto fourth = simd_sub_sat(simd_prev<3>(input, previous), simd_splat(0xf0 - 0x80));//* high bit set for 1111____
+			auto must_continue = simd_and(simd_or(third, fourth), simd_splat(0x80));
+			error = simd_or(error, simd_xor(must_continue, special));//* TWO_CONTS is the high bit, it cancels where a continuation was due
+			previous_incomplete = simd_sub_sat(input, incomplete_limits);
+		}
+		previous = input;
+	}
+
+	inline bool finish() { return !simd_any(simd_or(error, previous_incomplete)); }
+};
+
+inline bool utf8_valid_blocks(const char8_t* str, u64 size) {
+	Utf8Validator validator;
+	u64 i = 0;
+	for (; i + SIMD_WIDTH <= size; i += SIMD_WIDTH)
+		validator.block(simd_load(str + i));
+	if (i < size) {
+		u8 tail[SIMD_WIDTH] = {};//* padded with ascii
+		memcpy(tail, str + i, size - i);
+		validator.block(simd_load(tail));
+	}
+	return validator.finish();
+}
+
+//* code units of To needed to hold str, -1 when str isn't valid
+template<typename To, typename From> i64 utf_length(std::basic_string_view<From> str) {
+	if constexpr (sizeof(From) == 1 && SIMD_HAS_LOOKUP) {//* validated by blocks, then only lead bytes have to be counted
+		if (!utf8_valid_blocks(str.data(), str.size()))
+			return -1;
+		if constexpr (sizeof(To) == 1)
+			return str.size();
+		auto continuation_bits = simd_splat(0xc0), continuation = simd_splat(0x80), four_bytes = simd_splat(0xf0);
+		u64 length = str.size();//* a code point per byte that isn't a continuation, 4 byte ones take a surrogate pair in utf16
+		u64 i = 0;
+		for (; i + SIMD_WIDTH <= str.size(); i += SIMD_WIDTH) {
+			auto block = simd_load(str.data() + i);
+			length -= __builtin_popcount(simd_eq_mask(simd_and(block, continuation_bits), continuation));
+			if constexpr (sizeof(To) == 2)
+				length += __builtin_popcount(simd_eq_mask(simd_and(block, four_bytes), four_bytes));
+		}
+		for (u8 b : str.substr(i))
+			length += (sizeof(To) == 2 && b >= 0xf0) - ((b & 0xc0) == 0x80);
+		return length;
+	}
+	u64 length = 0;
+	u64 i = 0;
+	while (i < str.size()) {
+		if (i + UTF_ASCII_BLOCK<From> <= str.size() && utf_ascii_block(str.data() + i)) {
+			i += UTF_ASCII_BLOCK<From>;
+			length += UTF_ASCII_BLOCK<From>;
+			continue;
+		}
+		auto block_end = min(i + UTF_ASCII_BLOCK<From>, str.size());
+		while (i < block_end) {//* finish the block one code point at a time
+			auto cp = utf_decode(str.data(), str.size(), i);
+			if (cp == UTF_INVALID)
+				return -1;
+			length += utf_units<To>(cp);
+		}
+	}
+	return length;
+}
+
+template<typename C> inline bool utf_valid(std::basic_string_view<C> str) { return utf_length<C>(str) >= 0; }
+inline bool utf_valid(utf8 str) { return utf_valid<char8_t>(str); }
+inline bool utf_valid(utf16 str) { return utf_valid<char16_t>(str); }
+inline bool utf_valid(utf32 str) { return utf_valid<char32_t>(str); }
+
+//* null terminated like push_string, empty when str isn't valid
+template<typename To, typename From> std::basic_string_view<To> utf_transcode(Arena& arena, std::basic_string_view<From> str) {
+	auto length = utf_length<To>(str);
+	if (length < 0)
+		return {};
+	auto out = arena.push_array<To>(length + 1);
+	u64 i = 0;
+	u64 o = 0;
+	while (i < str.size()) {
+		if (i + UTF_ASCII_BLOCK<From> <= str.size() && utf_ascii_block(str.data() + i)) {
+			for (auto k : u64xrange{ 0, UTF_ASCII_BLOCK<From> })//* plain widening/narrowing copy
+				out[o + k] = To(str[i + k]);
+			i += UTF_ASCII_BLOCK<From>;
+			o += UTF_ASCII_BLOCK<From>;
+			continue;
+		}
+		auto block_end = min(i + UTF_ASCII_BLOCK<From>, str.size());
+		while (i < block_end)
+			o += utf_encode(utf_decode(str.data(), str.size(), i), out.data() + o);
+	}
+	out[o] = 0;
+	return std::basic_string_view<To>(out.data(), o);
+}
+
+inline utf16 to_utf16(Arena& arena, utf8 str) { return utf_transcode<char16_t>(arena, str); }
+inline utf32 to_utf32(Arena& arena, utf8 str) { return utf_transcode<char32_t>(arena, str); }
+inline utf8 to_utf8(Arena& arena, utf16 str) { return utf_transcode<char8_t>(arena, str); }
+inline utf32 to_utf32(Arena& arena, utf16 str) { return utf_transcode<char32_t>(arena, str); }
+inline utf8 to_utf8(Arena& arena, utf32 str) { return utf_transcode<char8_t>(arena, str); }
+inline utf16 to_utf16(Arena& arena, utf32 str) { return utf_transcode<char16_t>(arena, str); }
+
+#endif
@@ -9,6 +9,8 @@
 #define panic() __builtin_trap()
 #define assert(x) if (!(x)) panic()
 #include <tuple>
+#include <type_traits>
+#include <concepts>
 #include <stdio.h>
 #include <strings.h>
 
@@ -70,10 +72,6 @@ template<usize S, typename T> auto to_tuple(Array<T> arr) {
 	return to_tuple_helper(std::make_integer_sequence<u64, S>{}, arr);
 }
 
-template<typename T> i64 linear_search(Array<T> arr, const T& obj, i64 start = 0) {
-	return linear_search(arr, [&](const T& it) {return it == obj;}, start);
-}
-
 template<typename T, usize S> inline consteval usize array_size(const T(&)[S]) { return S; }
 template<typename T, usize S> inline constexpr auto larray(T(&arr)[S]) { return Array<T>(arr, S); }
 template<typename T> inline auto constexpr carray(T* arr, usize s) { return Array<T>(arr, s); }
@@ -94,6 +92,19 @@ inline bool has_all(auto flags, auto mask) { return (flags & mask) == mask; }
 inline bool has_one(auto flags, auto mask) { return flags & mask; }
 
 inline u32 ffs(auto flag) { return __builtin_ffsll(flag); }
+//! undefined for 0
+inline u32 ctz(auto flag) { return __builtin_ctzll(flag); }
+inline constexpr u64 rotl(u64 value, u32 shift) { return (value << shift) | (value >> ((64 - shift) & 63)); }
+
+//* murmur3 finalizer
+inline constexpr u64 hash_mix(u64 value) {
+	value ^= value >> 33;
+	value *= 0xff51afd7ed558ccdull;
+	value ^= value >> 33;
+	value *= 0xc4ceb9fe1a85ec53ull;
+	value ^= value >> 33;
+	return value;
+}
 inline string flag_name(Array<string> names, auto flag) { return names[ffs(flag)]; }
 
 constexpr auto null = nullptr;
@@ -181,13 +192,64 @@ template<typename Ta, typename Tb> auto parallel_iter(Array<Ta> arra, Array<Tb>
 	};
 }
 
+//* zips any number of arrays, stopping at the shortest, elements are yielded as a tuple of references
+template<typename... T> struct zip_it {
+	tuple<T*...> ptrs;
+	auto& operator++() { std::apply([](auto*&... p) { (p++, ...); }, ptrs); return *this; }
+	auto operator*() const { return std::apply([](auto*... p) { return tuple<T&...>(*p...); }, ptrs); }
+	bool operator!=(const zip_it<T...>& rhs) const { return std::get<0>(ptrs) != std::get<0>(rhs.ptrs); }
+};
+
+//* fixed width blocks of every array, std::span<T, W> has a compile time size so loops over it vectorize reliably
+template<u64 W, typename... T> struct zip_batch_it {
+	tuple<T*...> ptrs;
+	auto& operator++() { std::apply([](auto*&... p) { ((p += W), ...); }, ptrs); return *this; }
+	auto operator*() const { return std::apply([](auto*... p) { return tuple(std::span<T, W>(p, W)...); }, ptrs); }
+	bool operator!=(const zip_batch_it<W, T...>& rhs) const { return std::get<0>(ptrs) != std::get<0>(rhs.ptrs); }
+};
+
+template<typename... T> struct zip_range {
+	tuple<T*...> data;
+	u64 count;
+
+	inline u64 size() const { return count; }
+	inline auto offset(u64 index) const { return std::apply([&](auto*... p) { return tuple<T*...>((p + index)...); }, data); }
+	inline auto begin() const { return zip_it<T...>{ data }; }
+	inline auto end() const { return zip_it<T...>{ offset(count) }; }
+	inline auto operator[](u64 index) const { return std::apply([&](auto*... p) { return tuple<T&...>(p[index]...); }, data); }
+
+	//* the count % W elements left after the blocks are covered by tail<W>()
+	template<u64 W> inline it_range<zip_batch_it<W, T...>> batched() const { return { { data }, { offset(count - count % W) } }; }
+	template<u64 W> inline zip_range<T...> tail() const { return { offset(count - count % W), count % W }; }
+};
+
+template<typename... T> zip_range<T...> zip(Array<T>... arrays) {
+	static_assert(sizeof...(T) > 0);
+	u64 count = ~0ull;
+	((count = min(count, u64(arrays.size()))), ...);
+	return { tuple<T*...>(arrays.data()...), count };
+}
+
+//* i1 = i / size & i2 = (i + 1 + i1) % size, maintained incrementally
+//* see tiled_pairs for a cache friendly order over big counts
 template<typename N> struct self_combinatronic_it {
 	N i;
 	N size;
-	auto& operator++() { i++; return *this; }
+	N i1 = 0;
+	N i2 = 0;
+	N column = 0;//* i % size
+	auto& operator++() {
+		i++;
+		auto step = ++column == size ? 2 : 1;
+		if (step == 2) {
+			column = 0;
+			i1++;
+		}
+		i2 += step;
+		while (i2 >= size && size > 0) i2 -= size;
+		return *this;
+	}
 	auto operator*() {
-		auto i1 = i / size;
-		auto i2 = (i + 1 + i1) % size;
 		assert(i1 < size);
 		assert(i2 < size);
 		return tuple(i1, i2);
@@ -197,29 +259,174 @@ template<typename N> struct self_combinatronic_it {
 
 template<typename N> it_range<self_combinatronic_it<N>> self_combinatronic_idx(N count) {
 	return {
-		self_combinatronic_it<N> { 0, count },
+		self_combinatronic_it<N> { 0, count, 0, N(count > 1 ? 1 : 0) },
 		self_combinatronic_it<N> { count* (count - 1) / 2, count }
 	};
 }
 
-template<typename T, typename P> i64 linear_search(Array<T> arr, P predicate, i64 start = 0) {
-	for (auto i : iter_inc(array_indices(arr))) {
-		auto index = (i + start) % arr.size();
-		if (predicate(arr[index]))
-			return index;
+//* all pairs i < j of [0, count), visited tile by tile so both operand blocks of a tile stay in cache
+//* the diagonal tiles only hold their upper triangle, no division nor modulo per step
+template<typename N> struct tiled_pair_it {
+	N count, tile;
+	N ti, tj;//* origins of the current tile
+	N i, j;
+
+	inline N i_end() const { return min(ti + tile, count); }
+	inline N j_end() const { return min(tj + tile, count); }
+	inline N j_begin() const { return ti == tj ? i + 1 : tj; }
+
+	//* moves forward to the next valid pair, or to the end state
+	void settle() {
+		while (j >= j_end()) {
+			if (++i < i_end()) {
+				j = j_begin();
+				continue;
+			}
+			tj += tile;
+			if (tj >= count) {
+				ti += tile;
+				tj = ti;
+			}
+			if (ti >= count) {
+				ti = tj = i = j = count;
+				return;
+			}
+			i = ti;
+			j = j_begin();
+		}
+	}
+
+	auto& operator++() { j++; settle(); return *this; }
+	auto operator*() const { return tuple(i, j); }
+	bool operator!=(const tiled_pair_it<N>& rhs) const { return i != rhs.i || j != rhs.j; }
+
+	static tiled_pair_it at_tile(N count, N tile, N ti, N tj) {
+		if (ti >= count)
+			return { count, tile, count, count, count, count };
+		tiled_pair_it it = { count, tile, ti, tj, ti, ti == tj ? ti + 1 : tj };
+		it.settle();
+		return it;
+	}
+};
+
+//* one i against a contiguous block of j at a time, for vectorized inner loops
+template<typename N> struct tiled_pair_block_it {
+	tiled_pair_it<N> it;
+	auto& operator++() { it.j = it.j_end(); it.settle(); return *this; }
+	auto operator*() const { return tuple(it.i, num_range<N>{ it.j, it.j_end() }); }
+	bool operator!=(const tiled_pair_block_it<N>& rhs) const { return it != rhs.it; }
+};
+
+template<typename N> it_range<tiled_pair_it<N>> tiled_pairs(N count, N tile = 64) {
+	return { tiled_pair_it<N>::at_tile(count, tile, 0, 0), tiled_pair_it<N>::at_tile(count, tile, count, count) };
+}
+
+template<typename N> it_range<tiled_pair_block_it<N>> tiled_pair_blocks(N count, N tile = 64) {
+	auto pairs = tiled_pairs(count, tile);
+	return { { pairs.b }, { pairs.e } };
+}
+
+//* part-th of parts contiguous runs of tiles holding about the same number of pairs, for splitting the work across threads
+template<typename N> it_range<tiled_pair_it<N>> tiled_pairs_part(N count, N tile, u64 part, u64 parts) {
+	auto tile_pairs = [&](N ti, N tj) -> u64 {
+		u64 rows = min(ti + tile, count) - ti;
+		u64 cols = min(tj + tile, count) - tj;
+		return ti == tj ? rows * (rows - 1) / 2 : rows * cols;
+	};
+	u64 total = count > 1 ? u64(count) * (count - 1) / 2 : 0;
+	u64 first = total * part / parts;
+	u64 last = total * (part + 1) / parts;
+	u64 seen = 0;
+	auto begin = tiled_pair_it<N>::at_tile(count, tile, count, count);
+	auto end = begin;
+	bool begun = false;
+	for (N ti = 0; ti < count; ti += tile) for (N tj = ti; tj < count; tj += tile) {
+		if (!begun && seen >= first) {
+			begin = tiled_pair_it<N>::at_tile(count, tile, ti, tj);
+			begun = true;
+		}
+		if (seen >= last && part + 1 < parts)
+			return { begin, tiled_pair_it<N>::at_tile(count, tile, ti, tj) };
+		seen += tile_pairs(ti, tj);
 	}
+	return { begin, end };
+}
+
+//* start modulo size, negative starts count back from the end
+inline u64 wrap_start(i64 start, u64 size) { return ((start % i64(size)) + i64(size)) % i64(size); }
+
+//* searches [start, size) then wraps around to [0, start), as two plain loops rather than a modulo per element
+template<typename T, typename P> requires std::invocable<P&, T&> i64 linear_search(Array<T> arr, P predicate, i64 start = 0) {
+	if (arr.size() == 0)
+		return -1;
+	u64 wrap = wrap_start(start, arr.size());
+	for (auto i : u64xrange{ wrap, arr.size() }) if (predicate(arr[i]))
+		return i;
+	for (auto i : u64xrange{ 0, wrap }) if (predicate(arr[i]))
+		return i;
 	return -1;
 }
 
 template<typename T, typename P> i64 linear_search_idx(Array<T> arr, P predicate, i64 start = 0) {
-	for (auto i : iter_inc(array_indices(arr))) {
-		auto index = (i + start) % arr.size();
-		if (predicate(arr[index], index))
-			return index;
+	if (arr.size() == 0)
+		return -1;
+	u64 wrap = wrap_start(start, arr.size());
+	for (auto i : u64xrange{ wrap, arr.size() }) if (predicate(arr[i], i))
+		return i;
+	for (auto i : u64xrange{ 0, wrap }) if (predicate(arr[i], i))
+		return i;
+	return -1;
+}
+
+template<typename T> concept simd_element = std::is_arithmetic_v<T> && !std::is_same_v<T, bool>;
+
+//* index of the first element of [0, count) inside [low, high], or count, equality being the [value, value] range
+//* blocks of 32 bytes are tested with gcc/clang vector extensions, which lower to whatever the target has
+template<simd_element T> u64 vector_search(const T* data, u64 count, T low, T high) {
+	constexpr u64 LANES = 32 / sizeof(T);
+	typedef T Vector __attribute__((vector_size(32)));
+	typedef u64 Words __attribute__((vector_size(32)));
+	u64 i = 0;
+	for (; i + LANES <= count; i += LANES) {
+		Vector block;
+		__builtin_memcpy(&block, data + i, sizeof(block));
+		auto hits = (Words)((block >= low) & (block <= high));
+		if ((hits[0] | hits[1] | hits[2] | hits[3]) != 0)
+			break;//* the block has a match, the scalar loop finds which lane
 	}
+	for (; i < count; i++) if (data[i] >= low && data[i] <= high)
+		return i;
+	return count;
+}
+
+template<simd_element T> i64 vector_search_wrapping(Array<const T> arr, T low, T high, i64 start) {
+	if (arr.size() == 0)
+		return -1;
+	u64 wrap = wrap_start(start, arr.size());
+	if (auto found = wrap + vector_search(arr.data() + wrap, arr.size() - wrap, low, high); found < arr.size())
+		return found;
+	if (auto found = vector_search(arr.data(), wrap, low, high); found < wrap)
+		return found;
 	return -1;
 }
 
+template<typename T> i64 linear_search(Array<T> arr, const std::type_identity_t<T>& obj, i64 start = 0) {
+	using E = std::remove_cv_t<T>;
+	if constexpr (simd_element<E>)
+		return vector_search_wrapping<E>(arr, obj, obj, start);
+	else
+		return linear_search(arr, [&](const T& it) {return it == obj;}, start);
+}
+
+//* first element inside the inclusive range
+template<typename T> i64 range_search(Array<T> arr, num_range<std::remove_cv_t<T>> range, i64 start = 0) {
+	using E = std::remove_cv_t<T>;
+	if constexpr (simd_element<E>)
+		return vector_search_wrapping<E>(arr, range.min, range.max, start);
+	else
+		return linear_search(arr, [&](const T& it) { return range.contains_inc(it); }, start);
+}
+
 template<typename Callable> struct DeferedCall {
 	Callable call;
 	DeferedCall(Callable&& _call) : call(std::move(_call)) {}
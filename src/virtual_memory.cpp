@@ -3,25 +3,83 @@
 
 #include <memory.cpp>
 
-Buffer virtual_reserve(usize size, bool commit = false);
+//* numa placement of a range, applied to its pages as they get faulted in, modes are linux' MPOL_* values
+//* node masks have one bit per node, 64 nodes at most
+struct NumaPlacement {
+	enum Mode : u32 {
+		DEFAULT = 0,//* the thread's policy, first touch unless changed
+		PREFERRED = 1,//* the lowest node of nodes, other nodes once it is full
+		BIND = 2,//* nodes only, faults fail once they are full
+		INTERLEAVE = 3,//* pages round robin over nodes
+	};
+	u32 mode = DEFAULT;
+	u64 nodes = 0;
+};
+
+Buffer virtual_reserve(usize size, bool commit = false, NumaPlacement placement = {});
 Buffer virtual_commit(Buffer buffer);
-Buffer virtual_remake(Buffer buffer, u64 size, u64 content, u64 commit);
+Buffer virtual_remake(Buffer buffer, u64 size, u64 content, u64 commit, NumaPlacement placement = {});
 //! decommit whole pages, not just the buffer
 void virtual_decommit(Buffer buffer);
 void virtual_release(Buffer buffer);
+u64 virtual_page_size();
+//* faults committed pages in now instead of on first touch, keeps their content
+Buffer virtual_prefault(Buffer buffer);
+//* anonymous memory file, the owner maps it shared & copies map it privately to share its pages until they write them
+//* returns -1 on failure, on windows the descriptor is the section handle
+i32 shared_memory_create(u64 size);
+Buffer shared_memory_map(i32 fd, u64 size, bool copy_on_write);
+//* views aren't reservations, windows can't release them with virtual_release
+void shared_memory_unmap(Buffer mapping);
+void shared_memory_close(i32 fd);
+//* bit per page of a copy on write mapping, set for the pages it holds a private copy of
+//* false when the platform can't tell, callers then have to assume every page was written
+bool virtual_private_pages(Buffer mapping, Array<u64> bits);
+//* mbind, windows can only place at reservation time & returns false
+bool virtual_place(Buffer buffer, NumaPlacement placement);
+//* set_mempolicy, for every later fault of the calling thread outside of placed ranges
+bool thread_place(NumaPlacement placement);
+u32 numa_current_node();
+//* nodes the process may allocate on, queried once, a single bit without numa
+u64 numa_nodes();
+
+struct FileMap {
+	enum : u64 {
+		SEQUENTIAL = 1ull << 0,
+		WILL_NEED = 1ull << 1,
+		POPULATE = 1ull << 2,//* fault in the whole file at map time
+		HUGE_PAGES = 1ull << 3,//* align to huge page & hint, only when the file is big enough
+		PRIVATE = 1ull << 4,//* writes to mutable maps stay in memory & never reach the file
+	};
+	static constexpr u64 DEFAULT_FLAGS = SEQUENTIAL | WILL_NEED;
+	static constexpr u64 HUGE_PAGE_SIZE = 2ull << 20;
+};
+
+ROBuffer map_file(string path, u64 flags = FileMap::DEFAULT_FLAGS);
+//* size > 0 creates/resizes the file before mapping it
+Buffer map_file_mut(string path, u64 size = 0, u64 flags = FileMap::DEFAULT_FLAGS);
+void unmap_file(ROBuffer buffer);
 
 #ifdef BLBLSTD_IMPL
 
-Buffer virtual_remake(Buffer buffer, u64 size, u64 content, u64 commit) {
+Buffer virtual_remake(Buffer buffer, u64 size, u64 content, u64 commit, NumaPlacement placement) {
 	if (content > commit)
 		commit = content;
-	auto new_buffer = virtual_reserve(size, commit == size);
+	auto new_buffer = virtual_reserve(size, commit == size, placement);//* placed before the copy faults the pages in
 	if (commit > 0)
 		virtual_commit(new_buffer.subspan(0, min(commit, new_buffer.size())));
 	memcpy(new_buffer.data(), buffer.data(), min(content, new_buffer.size()));
 	return new_buffer;
 }
 
+//* a write per page, of the byte already there, the ranges prefaulted by arenas are poisoned
+__attribute__((no_sanitize_address)) void touch_pages(Buffer buffer, u64 page_size) {
+	for (auto page = buffer.data(); page < buffer.data() + buffer.size(); page += page_size) {
+		auto touched = (volatile byte*)page;
+		*touched = *touched;
+	}
+}
+
 #if defined(PLATFORM_WINDOWS)
 #include <windows.h>
 
@@ -37,8 +95,10 @@ void log_error(DWORD error_code, string source = "") {
 	}
 }
 
-Buffer virtual_reserve(usize size, bool commit) {
-	auto ptr = VirtualAlloc(null, size, MEM_RESERVE | (commit ? MEM_COMMIT : 0), PAGE_READWRITE);
+Buffer virtual_reserve(usize size, bool commit, NumaPlacement placement) {
+	auto type = MEM_RESERVE | (commit ? MEM_COMMIT : 0);
+	auto single_node = (placement.mode == NumaPlacement::PREFERRED || placement.mode == NumaPlacement::BIND) && placement.nodes;
+	auto ptr = single_node ? VirtualAllocExNuma(GetCurrentProcess(), null, size, type, PAGE_READWRITE, ctz(placement.nodes)) : VirtualAlloc(null, size, type, PAGE_READWRITE);
 	if (!ptr) {
 		log_error(GetLastError(), __PRETTY_FUNCTION__);
 		panic();
@@ -74,15 +134,188 @@ void virtual_release(Buffer buffer) {
 	}
 }
 
+i32 shared_memory_create(u64 size) {
+	auto section = CreateFileMappingA(INVALID_HANDLE_VALUE, null, PAGE_READWRITE, DWORD(size >> 32), DWORD(size), null);
+	if (section == null) {
+		log_error(GetLastError(), __PRETTY_FUNCTION__);
+		return -1;
+	}
+	return i32(intptr_t(section));//* kernel handles only use their low 32 bits
+}
+
+Buffer shared_memory_map(i32 fd, u64 size, bool copy_on_write) {
+	auto ptr = MapViewOfFile(HANDLE(intptr_t(fd)), copy_on_write ? FILE_MAP_COPY : FILE_MAP_WRITE, 0, 0, size);
+	if (ptr == null) {
+		log_error(GetLastError(), __PRETTY_FUNCTION__);
+		return Buffer{};
+	}
+	return Buffer((byte*)ptr, size);
+}
+
+void shared_memory_unmap(Buffer mapping) {
+	if (!UnmapViewOfFile(mapping.data())) {
+		log_error(GetLastError(), __PRETTY_FUNCTION__);
+		panic();
+	}
+}
+
+void shared_memory_close(i32 fd) { CloseHandle(HANDLE(intptr_t(fd))); }
+
+bool virtual_private_pages(Buffer, Array<u64>) { return false; }
+
+u64 virtual_page_size() {
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwPageSize;
+}
+
+Buffer virtual_prefault(Buffer buffer) {
+	touch_pages(buffer, virtual_page_size());
+	return buffer;
+}
+
+bool virtual_place(Buffer, NumaPlacement) { return false; }
+bool thread_place(NumaPlacement) { return false; }
+
+u32 numa_current_node() {
+	PROCESSOR_NUMBER processor;
+	GetCurrentProcessorNumberEx(&processor);
+	USHORT node = 0;
+	GetNumaProcessorNodeEx(&processor, &node);
+	return node;
+}
+
+u64 numa_nodes() {
+	static const u64 nodes = [] {
+		ULONG highest = 0;
+		if (!GetNumaHighestNodeNumber(&highest))
+			return u64(1);
+		return highest >= 63 ? ~u64(0) : bit<u64>(highest + 1) - 1;
+	}();
+	return nodes;
+}
+
+Buffer map_file_handle(string path, u64 size, u64 flags, bool writable) {
+	auto file = CreateFileA(
+		(LPCSTR)path.data(),
+		GENERIC_READ | (writable ? GENERIC_WRITE : 0),
+		FILE_SHARE_READ,
+		null,
+		(writable && size > 0) ? OPEN_ALWAYS : OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | ((flags & FileMap::SEQUENTIAL) ? FILE_FLAG_SEQUENTIAL_SCAN : 0),
+		null
+	);
+	if (file == INVALID_HANDLE_VALUE) {
+		log_error(GetLastError(), __PRETTY_FUNCTION__);
+		return Buffer{};
+	}
+	defer{ CloseHandle(file); };
+
+	LARGE_INTEGER file_size = {};
+	if (size > 0)
+		file_size.QuadPart = size;
+	else if (!GetFileSizeEx(file, &file_size)) {
+		log_error(GetLastError(), __PRETTY_FUNCTION__);
+		return Buffer{};
+	}
+	if (file_size.QuadPart == 0)
+		return Buffer{};
+
+	auto copy_on_write = writable && (flags & FileMap::PRIVATE);
+	auto protection = !writable ? PAGE_READONLY : copy_on_write ? PAGE_WRITECOPY : PAGE_READWRITE;
+	auto mapping = CreateFileMappingA(file, null, protection, file_size.HighPart, file_size.LowPart, null);
+	if (mapping == null) {
+		log_error(GetLastError(), __PRETTY_FUNCTION__);
+		return Buffer{};
+	}
+	defer{ CloseHandle(mapping); };//* the view keeps the mapping alive
+
+	auto access = !writable ? FILE_MAP_READ : copy_on_write ? FILE_MAP_COPY : FILE_MAP_WRITE;
+	auto ptr = MapViewOfFile(mapping, access, 0, 0, file_size.QuadPart);
+	if (ptr == null) {
+		log_error(GetLastError(), __PRETTY_FUNCTION__);
+		return Buffer{};
+	}
+	return Buffer((byte*)ptr, file_size.QuadPart);
+}
+
+void unmap_file(ROBuffer buffer) {
+	if (buffer.size() == 0) return;
+	if (!UnmapViewOfFile(buffer.data()))
+		log_error(GetLastError(), __PRETTY_FUNCTION__);
+}
+
 #elif defined(PLATFORM_LINUX) || defined(PLATFORM_OSX) || defined(PLATFORM_ANDROID)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/syscall.h>
+
+//* raw syscalls rather than libnuma, the kernel reads maxnode - 1 bits of the mask
+constexpr u64 NUMA_MAX_NODE = 64 + 1;
+
+bool virtual_place(Buffer buffer, NumaPlacement placement) {
+#ifdef SYS_mbind
+	if (buffer.size() == 0)
+		return true;
+	auto nodes = placement.nodes;
+	auto masked = placement.mode != NumaPlacement::DEFAULT;
+	if (syscall(SYS_mbind, buffer.data(), buffer.size(), placement.mode, masked ? &nodes : null, masked ? NUMA_MAX_NODE : 0, 0) != 0)
+		return fail_ret(strerror(errno), false);
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool thread_place(NumaPlacement placement) {
+#ifdef SYS_set_mempolicy
+	auto nodes = placement.nodes;
+	auto masked = placement.mode != NumaPlacement::DEFAULT;
+	if (syscall(SYS_set_mempolicy, placement.mode, masked ? &nodes : null, masked ? NUMA_MAX_NODE : 0) != 0)
+		return fail_ret(strerror(errno), false);
+	return true;
+#else
+	return false;
+#endif
+}
+
+u32 numa_current_node() {
+	u32 cpu = 0, node = 0;
+#ifdef SYS_getcpu
+	if (syscall(SYS_getcpu, &cpu, &node, null) != 0)
+		return 0;
+#endif
+	return node;
+}
+
+u64 numa_nodes() {
+	static const u64 nodes = [] {
+		u64 mask = 0;
+#ifdef SYS_get_mempolicy
+		constexpr u64 MPOL_F_MEMS_ALLOWED = 1 << 2;
+		i32 mode = 0;
+		if (syscall(SYS_get_mempolicy, &mode, &mask, NUMA_MAX_NODE, null, MPOL_F_MEMS_ALLOWED) != 0)
+			mask = 0;
+#endif
+		return mask ? mask : 1;
+	}();
+	return nodes;
+}
 
-Buffer virtual_reserve(usize size, bool commit) {
+Buffer virtual_reserve(usize size, bool commit, NumaPlacement placement) {
 	auto ptr = mmap(null, size, commit ? PROT_READ | PROT_WRITE : PROT_NONE, MAP_PRIVATE | MAP_ANON, -1, 0);
 	if (ptr == MAP_FAILED) {
 		//TODO logs from errno
 		return Buffer{};
 	}
-	return Buffer((byte*)ptr, size);
+	auto buffer = Buffer((byte*)ptr, size);
+	if (placement.mode != NumaPlacement::DEFAULT)
+		virtual_place(buffer, placement);//* nothing is faulted in yet, so every page follows it
+	return buffer;
 }
 
 Buffer virtual_commit(Buffer buffer) {
@@ -96,10 +329,10 @@ Buffer virtual_commit(Buffer buffer) {
 }
 
 void virtual_decommit(Buffer buffer) {
+	madvise(buffer.data(), buffer.size(), MADV_DONTNEED);//* PROT_NONE alone keeps the pages resident
 	auto failure = mprotect(buffer.data(), buffer.size(), PROT_NONE);
 	if (failure) {
 		//TODO logs from errno
-		return Buffer{};
 	}
 }
 
@@ -110,8 +343,164 @@ void virtual_release(Buffer buffer) {
 	}
 }
 
+i32 shared_memory_create(u64 size) {
+#ifdef SYS_memfd_create
+	i32 fd = syscall(SYS_memfd_create, "blblstd_shared", 1u/* MFD_CLOEXEC */);
+#else
+	char name[64];
+	snprintf(name, sizeof(name), "/blblstd_shared_%d_%p", i32(getpid()), (any*)&name);
+	i32 fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+	if (fd >= 0)
+		shm_unlink(name);//* only the descriptor & the mappings keep it alive
+#endif
+	if (fd < 0)
+		return fail_ret(strerror(errno), -1);
+	if (ftruncate(fd, size) != 0) {//* sparse, pages only exist once written
+		fail_msg(strerror(errno));
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+Buffer shared_memory_map(i32 fd, u64 size, bool copy_on_write) {
+	auto ptr = mmap(null, size, PROT_READ | PROT_WRITE, copy_on_write ? MAP_PRIVATE : MAP_SHARED, fd, 0);
+	if (ptr == MAP_FAILED)
+		return fail_ret(strerror(errno), Buffer{});
+	return Buffer((byte*)ptr, size);
+}
+
+void shared_memory_unmap(Buffer mapping) {
+	if (munmap(mapping.data(), mapping.size()) != 0)
+		fail_msg(strerror(errno));
+}
+
+void shared_memory_close(i32 fd) { close(fd); }
+
+//* /proc/self/pagemap : a written copy on write page turns anonymous, so it is present or swapped without the file page bit
+bool virtual_private_pages(Buffer mapping, Array<u64> bits) {
+#ifdef PLATFORM_LINUX
+	constexpr u64 PRESENT = 1ull << 63, SWAPPED = 1ull << 62, FILE_PAGE = 1ull << 61;
+	constexpr u64 BATCH = 512;
+	auto page_size = virtual_page_size();
+	auto pages = (mapping.size() + page_size - 1) / page_size;
+	assert(bits.size() * 64 >= pages);
+	auto fd = open("/proc/self/pagemap", O_RDONLY);
+	if (fd < 0)
+		return false;
+	defer{ close(fd); };
+	u64 entries[BATCH];
+	for (u64 first = 0; first < pages; first += BATCH) {
+		auto count = min(pages - first, BATCH);
+		auto offset = (uintptr_t(mapping.data()) / page_size + first) * sizeof(u64);
+		if (pread(fd, entries, count * sizeof(u64), offset) != i64(count * sizeof(u64)))
+			return false;
+		for (auto i : u64xrange{ 0, count }) {
+			auto page = first + i;
+			auto written = (entries[i] & (PRESENT | SWAPPED)) && !(entries[i] & FILE_PAGE);
+			bits[page / 64] = (bits[page / 64] & ~bit<u64>(page % 64)) | (u64(written) << (page % 64));
+		}
+	}
+	return true;
+#else
+	return false;
+#endif
+}
+
+u64 virtual_page_size() {
+	static const u64 page_size = sysconf(_SC_PAGESIZE);
+	return page_size;
+}
+
+Buffer virtual_prefault(Buffer buffer) {
+	if (buffer.size() == 0)
+		return buffer;
+	auto page_size = virtual_page_size();
+	auto start = (byte*)(uintptr_t(buffer.data()) & ~(page_size - 1));
+	auto pages = Buffer(start, buffer.data() + buffer.size() - start);
+#ifdef PLATFORM_LINUX
+	constexpr i32 POPULATE_WRITE = 23;//* MADV_POPULATE_WRITE, linux 5.14, older headers lack it
+	if (madvise(pages.data(), pages.size(), POPULATE_WRITE) == 0)
+		return buffer;
+#endif
+	touch_pages(pages, page_size);//* older kernels, one fault per page
+	return buffer;
+}
+
+//* reserves an oversized PROT_NONE range to carve an aligned slot out of, returns null when not worth it
+byte* reserve_aligned_slot(u64 size, u64 align, Buffer& reservation) {
+	reservation = virtual_reserve(size + align);
+	if (reservation.size() == 0)
+		return null;
+	return reservation.data() + (-uintptr_t(reservation.data()) & (align - 1));
+}
+
+Buffer map_file_handle(string path, u64 size, u64 flags, bool writable) {
+	auto fd = open(path.data(), writable ? (O_RDWR | (size > 0 ? O_CREAT : 0)) : O_RDONLY, 0644);
+	if (fd < 0)
+		return fail_ret(strerror(errno), Buffer{});
+	defer{ close(fd); };//* the mapping keeps its own reference on the file
+
+	if (size > 0) {
+		if (ftruncate(fd, size) != 0)
+			return fail_ret(strerror(errno), Buffer{});
+	} else {
+		struct stat info;
+		if (fstat(fd, &info) != 0)
+			return fail_ret(strerror(errno), Buffer{});
+		size = info.st_size;
+	}
+	if (size == 0)
+		return Buffer{};
+
+	i32 map_flags = (writable && !(flags & FileMap::PRIVATE)) ? MAP_SHARED : MAP_PRIVATE;
+#ifdef MAP_POPULATE
+	if (flags & FileMap::POPULATE)
+		map_flags |= MAP_POPULATE;
+#endif
+
+	Buffer reservation = {};
+	byte* slot = null;
+	if ((flags & FileMap::HUGE_PAGES) && size >= FileMap::HUGE_PAGE_SIZE && (slot = reserve_aligned_slot(size, FileMap::HUGE_PAGE_SIZE, reservation)))
+		map_flags |= MAP_FIXED;//* replaces part of our own reservation, nothing else can live there
+
+	auto ptr = mmap(slot, size, writable ? PROT_READ | PROT_WRITE : PROT_READ, map_flags, fd, 0);
+	if (ptr == MAP_FAILED) {
+		if (reservation.size() > 0) virtual_release(reservation);
+		return fail_ret(strerror(errno), Buffer{});
+	}
+	auto buffer = Buffer((byte*)ptr, size);
+
+	if (reservation.size() > 0) {//* give back what's left of the reservation around the aligned slot
+		auto page_size = u64(sysconf(_SC_PAGESIZE));
+		auto mapped_end = buffer.data() + ((size + page_size - 1) & ~(page_size - 1));
+		if (buffer.data() > reservation.data())
+			munmap(reservation.data(), buffer.data() - reservation.data());
+		if (mapped_end < reservation.data() + reservation.size())
+			munmap(mapped_end, reservation.data() + reservation.size() - mapped_end);
+#ifdef MADV_HUGEPAGE
+		madvise(buffer.data(), size, MADV_HUGEPAGE);
+#endif
+	}
+
+	if (flags & FileMap::SEQUENTIAL)
+		madvise(buffer.data(), size, MADV_SEQUENTIAL);
+	if (flags & FileMap::WILL_NEED)
+		madvise(buffer.data(), size, MADV_WILLNEED);
+	return buffer;
+}
+
+void unmap_file(ROBuffer buffer) {
+	if (buffer.size() == 0) return;
+	if (munmap((any*)buffer.data(), buffer.size()) != 0)
+		fail_msg(strerror(errno));
+}
+
 #endif
 
+ROBuffer map_file(string path, u64 flags) { return map_file_handle(path, 0, flags, false); }
+Buffer map_file_mut(string path, u64 size, u64 flags) { return map_file_handle(path, size, flags, true); }
+
 #endif
 
 #endif
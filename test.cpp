@@ -38,7 +38,7 @@ i32 main(i32 ac, const cstrp argv[]) {
 			printf("\n");
 
 			printf("v_arena memory used : %llu/%llu\n", v_arena.current, v_arena.bytes.size());
-			auto filtered = filter(v_arena, sorted, [](Test t) { return (t.score % 2) == 1; });
+			auto filtered = filter(v_arena, Array<const Test>(sorted), [](Test t) { return (t.score % 2) == 1; });
 			printf("filtered : ");
 			for (auto&& i : filtered)
 				printf("%i, ", i.score);
@@ -61,5 +61,145 @@ i32 main(i32 ac, const cstrp argv[]) {
 		}
 	());
 
+	{//* a deadline on a level boundary cascades at the tick it is due & has to fire in that advance
+		auto [arena, scope] = scratch_push_scope(); defer{ scratch_pop_scope(arena, scope); };
+		auto wheel = TimerWheel<u32>::make();
+		wheel.schedule(arena, 256, 256);
+		wheel.schedule(arena, 100, 100);
+		wheel.schedule(arena, 65536, 65536);
+		assert(wheel.advance(arena, 256).size() == 2);
+		assert(wheel.advance(arena, 65535).size() == 0);
+		auto fired = wheel.advance(arena, 65536);
+		assert(fired.size() == 1 && fired[0] == 65536);
+		printf("timer wheel boundaries : ok\n");
+	}
+
+	{//* a NaN leading a chunk must not hide the rest of the chunk, the vector path has to pick what the scalar loop picks
+		f32 values[600];
+		for (auto i : u64xrange{ 0, 600 })
+			values[i] = f32((i * 37) % 101);
+		values[256] = __builtin_nanf("");
+		values[300] = 1000;
+		auto reference = [&]() {
+			i64 index = 0;
+			for (auto i : u64xrange{ 1, 600 }) if (values[i] > values[index])
+				index = i;
+			return index;
+		};
+		auto identity = [](f32 v) { return v; };
+		assert(arg_max(carray(values + 256, 256)) == 300 - 256);
+		assert(best_fit_search(carray(values, 600), identity) == 300 && reference() == 300);
+		values[0] = __builtin_nanf("");
+		assert(best_fit_search(carray(values, 600), identity) == reference());
+		assert(arg_max(carray(values, 600)) == 300 && arg_min(carray(values, 600)) == 101);
+		for (auto& v : values)
+			v = __builtin_nanf("");
+		assert(arg_max(carray(values, 600)) == -1);
+		printf("best fit with NaNs : ok\n");
+	}
+
+	{//* nested budgets : a charge goes up the chain & a refusal anywhere leaves every level as it was
+		constexpr u64 CHUNK = Arena::COMMIT_CHUNK_SIZE;
+		u64 soft_calls = 0;
+		MemoryBudget process = { .hard_limit = CHUNK * 4 };
+		MemoryBudget subsystem = { .parent = &process, .soft_limit = CHUNK * 2, .on_soft_limit = [](any* context, MemoryBudget&) { (*(u64*)context)++; }, .context = (any*)&soft_calls };
+		auto arena = Arena::from_vmem(1 << 20, Arena::COMMIT_ON_PUSH | Arena::DECOMMIT_ON_EMPTY | Arena::ALLOW_FAILURE, &subsystem);
+		arena.push_array<byte>(CHUNK * 3 - 1);
+		assert(subsystem.committed == CHUNK * 3 && process.committed == CHUNK * 3 && soft_calls == 1);
+		arena.push_array<byte>(CHUNK);
+		assert(process.committed == CHUNK * 4 && soft_calls == 1);
+		assert(arena.push_array<byte>(CHUNK).size() == 0);
+		assert(process.refused == 1 && subsystem.refused == 0 && subsystem.committed == CHUNK * 4 && process.committed == CHUNK * 4);
+		arena.pop_to(0);
+		assert(subsystem.committed == 0 && process.committed == 0);
+		arena.push_array<byte>(CHUNK * 3 - 1);
+		assert(soft_calls == 2);//* once per upward crossing
+		arena.vmem_release();
+		assert(subsystem.committed == 0 && process.committed == 0);
+
+		MemoryBudget budget = {};
+		auto trimmed = Arena::from_vmem(1 << 20, Arena::COMMIT_ON_PUSH, &budget);
+		trimmed.push_array<byte>(CHUNK * 4);
+		assert(trimmed.commit == CHUNK * 5 && budget.committed == CHUNK * 5);
+		trimmed.pop_to(CHUNK + 1);
+		assert(trimmed.trim() == CHUNK * 3 && trimmed.commit == CHUNK * 2 && budget.committed == CHUNK * 2);
+		assert(trimmed.trim() == 0);
+		trimmed.vmem_release();
+		assert(budget.committed == 0);
+
+		budget.hard_limit = 1 << 20;
+		auto full = Arena::from_vmem(1 << 16, Arena::FULL_COMMIT, &budget);
+		assert(budget.committed == 1 << 16);
+		auto over = Arena::from_vmem(1 << 20, Arena::FULL_COMMIT | Arena::ALLOW_FAILURE, &budget);
+		assert(over.bytes.size() == 0 && budget.refused == 1 && budget.committed == 1 << 16);
+		budget.hard_limit = MemoryBudget::UNLIMITED;
+		auto unreservable = Arena::from_vmem(1ull << 60, Arena::FULL_COMMIT | Arena::ALLOW_FAILURE, &budget);
+		assert(unreservable.bytes.size() == 0 && budget.committed == 1 << 16);
+		full.vmem_release();
+		assert(budget.committed == 0);
+		printf("memory budgets : ok\n");
+	}
+
+	{//* a fork sees the parent's pages, its writes stay private until promoted & vanish when discarded
+		auto parent = arena_shared(1 << 20);
+		assert(parent.bytes.size() == 1 << 20 && parent.fd >= 0);
+		auto base = parent.push_array<u32>(4096);
+		for (auto i : u64xrange{ 0, base.size() })
+			base[i] = u32(i);
+
+		auto fork = arena_fork(parent);
+		assert(fork.current == parent.current && fork.fd == Arena::FORK_FD);
+		auto forked = cast<u32>(fork.used());
+		assert(forked[4095] == 4095);
+		forked[10] = 1000;
+		auto extra = fork.push_array<u32>(8192);//* past the parent's scope, on pages the parent never wrote
+		for (auto i : u64xrange{ 0, extra.size() })
+			extra[i] = u32(i * 3);
+		assert(base[10] == 10);
+		arena_discard(fork);
+		assert(fork.bytes.size() == 0 && base[10] == 10 && parent.current == 4096 * sizeof(u32));
+
+		fork = arena_fork(parent);
+		cast<u32>(fork.used())[10] = 2000;
+		extra = fork.push_array<u32>(8192);
+		for (auto i : u64xrange{ 0, extra.size() })
+			extra[i] = u32(i * 3);
+		auto fork_current = fork.current;
+		arena_promote(parent, fork);
+		assert(fork.bytes.size() == 0 && parent.current == fork_current);
+		auto promoted = cast<u32>(parent.used());
+		assert(promoted[10] == 2000 && promoted[11] == 11 && promoted[4095] == 4095);
+		for (auto i : u64xrange{ 0, 8192 })
+			assert(promoted[4096 + i] == u32(i * 3));
+		parent.vmem_release();
+		printf("arena fork & promote : ok\n");
+	}
+
+	{//* prefault commits the prefix up front & charges it like pushes would, without touching what's already there
+		constexpr u64 CHUNK = Arena::COMMIT_CHUNK_SIZE;
+		MemoryBudget budget = {};
+		auto arena = Arena::from_vmem(1 << 20, Arena::COMMIT_ON_PUSH | Arena::DECOMMIT_ON_EMPTY, &budget, CHUNK * 3 + 1);
+		assert(arena.commit == CHUNK * 4 && budget.committed == CHUNK * 4 && arena.current == 0);
+		auto values = arena.push_array<u64>(CHUNK * 2 / sizeof(u64));
+		for (auto i : u64xrange{ 0, values.size() })
+			values[i] = i * i;
+		assert(arena.commit == CHUNK * 4 && budget.committed == CHUNK * 4);//* the pushes fit in the prefaulted prefix
+		arena.prefault(CHUNK * 6);
+		assert(arena.commit == CHUNK * 6 && budget.committed == CHUNK * 6);
+		for (auto i : u64xrange{ 0, values.size() })
+			assert(values[i] == i * i);
+		arena.prefault(CHUNK);
+		assert(arena.commit == CHUNK * 6);//* never shrinks
+		arena.pop_to(0);
+		assert(arena.commit == 0 && budget.committed == 0);
+		arena.vmem_release();
+
+		auto full = Arena::from_vmem(1 << 16, Arena::FULL_COMMIT, &budget, 1 << 20);//* clamped to the reservation
+		assert(full.commit == 1 << 16 && budget.committed == 1 << 16);
+		full.vmem_release();
+		assert(budget.committed == 0);
+		printf("arena prefault : ok\n");
+	}
+
 	return 0;
 }